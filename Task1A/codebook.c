@@ -0,0 +1,553 @@
+/**
+ * @file    codebook.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the codebook module
+ */
+
+#include "codebook.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#define MAXSEEDS (10000)
+#define MAXTABLEBITS (24)
+#define ALIGN8(x) (((x) + 7) & ~(size_t) 7)
+
+static struct codebook *mapCodebook(const char *path);
+static struct codebook *parseCodebook(const char *path);
+static int checkCodebook(const struct codebook *book, size_t size);
+static int isDelimiter(char c);
+static int parseSymbol(const char *token, unsigned char *symbol);
+
+struct codebook *compileCodebook(const struct codebookEntry *entries, size_t count)
+{
+    struct codebook *book;
+    struct cbSpan *spans;
+    struct cbSlot *slots;
+    char *text;
+    size_t nspans = 1;
+    size_t textsize = 2 + CODEBOOK_SLACK;
+    size_t maxspan = 1;
+    size_t size;
+    uint32_t tablebits = 4;
+    uint32_t counts[256] = { 0 };
+    int folded[256] = { 0 };
+
+    for(size_t i = 0; i < count; i++){
+        const size_t length = strlen(entries[i].word);
+        const unsigned char c = entries[i].symbol;
+
+        if(c == '\n' || c == '\0' || c == 0xff){
+            (void) fprintf(stderr, "codebook: symbol 0x%02x can not be encoded\n", c);
+            return NULL;
+        }
+        if(length == 0 || length > CODEBOOK_MAXWORD){
+            (void) fprintf(stderr, "codebook: bad length of codeword \"%s\"\n", entries[i].word);
+            return NULL;
+        }
+        for(size_t j = 0; j < length; j++){
+            if(isDelimiter(entries[i].word[j]) || entries[i].word[j] == '\0'){
+                (void) fprintf(stderr, "codebook: codeword \"%s\" contains a delimiter\n", entries[i].word);
+                return NULL;
+            }
+        }
+
+        counts[c]++;
+        nspans++;
+        textsize += length + 1;
+        if(length + 1 > maxspan){
+            maxspan = length + 1;
+        }
+    }
+
+    //Letters without entry use the words of the other case
+    for(int c = 'A'; c <= 'Z'; c++){
+        const int lower = tolower(c);
+
+        if(counts[c] == 0 && counts[lower] > 0){
+            folded[c] = lower;
+        }else if(counts[lower] == 0 && counts[c] > 0){
+            folded[lower] = c;
+        }
+    }
+
+    while(((size_t) 1 << tablebits) < 4 * count){
+        tablebits++;
+    }
+
+    //Decode table grows if no multiplier is found
+    for(; tablebits <= MAXTABLEBITS; tablebits++){
+        const size_t nslots = (size_t) 1 << tablebits;
+        const size_t spansoffset = ALIGN8(sizeof(struct codebook));
+        const size_t slotsoffset = spansoffset + ALIGN8(nspans * sizeof(struct cbSpan));
+        const size_t textoffset = slotsoffset + nslots * sizeof(struct cbSlot);
+        size_t textlength = 0;
+        size_t span = 1;
+
+        size = textoffset + textsize;
+        book = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(book == MAP_FAILED){
+            return NULL;
+        }
+
+        (void) memcpy(book->magic, CODEBOOK_MAGIC, sizeof(book->magic));
+        book->version = CODEBOOK_VERSION;
+        book->size = (uint32_t) size;
+        book->tablebits = tablebits;
+        book->nspans = (uint32_t) nspans;
+        book->maxspan = (uint32_t) maxspan;
+        book->spansoffset = (uint32_t) spansoffset;
+        book->slotsoffset = (uint32_t) slotsoffset;
+        book->textoffset = (uint32_t) textoffset;
+
+        spans = (struct cbSpan *) ((char *) book + spansoffset);
+        slots = (struct cbSlot *) ((char *) book + slotsoffset);
+        text = (char *) book + textoffset;
+
+        //Span 0 is the empty word
+        text[textlength++] = ' ';
+        spans[0].offset = 0;
+        spans[0].length = 1;
+
+        for(int c = 0; c < 256; c++){
+            book->symbols[c].first = 0;
+            book->symbols[c].count = (c == '\n' || c == '\0' || c == 0xff) ? 0 : 1;
+
+            if(counts[c] == 0){
+                continue;
+            }
+
+            book->symbols[c].first = (uint32_t) span;
+            book->symbols[c].count = counts[c];
+
+            for(size_t i = 0; i < count; i++){
+                if(entries[i].symbol == c){
+                    const size_t length = strlen(entries[i].word);
+
+                    spans[span].offset = (uint32_t) textlength;
+                    spans[span].length = (uint32_t) length + 1;
+                    (void) memcpy(&text[textlength], entries[i].word, length);
+                    text[textlength + length] = ' ';
+                    textlength += length + 1;
+                    span++;
+                }
+            }
+        }
+
+        for(int c = 0; c < 256; c++){
+            if(folded[c] != 0){
+                book->symbols[c] = book->symbols[folded[c]];
+            }
+        }
+
+        for(uint64_t seed = 1; seed <= MAXSEEDS; seed++){
+            int collision = 0;
+
+            book->multiplier = (seed * 0x9e3779b97f4a7c15ull) | 1;
+            (void) memset(slots, 0, nslots * sizeof(struct cbSlot));
+
+            for(size_t i = 0; i < count && !collision; i++){
+                const unsigned char c = entries[i].symbol;
+                const char *word = entries[i].word;
+                const size_t length = strlen(word);
+                const uint64_t key = codebookKey(word, length);
+                struct cbSlot *slot = &slots[codebookHash(book, key, word, length)];
+
+                if(slot->length != 0){
+                    if(slot->length == length && memcmp(&text[slot->offset], word, length) == 0){
+                        if(slot->plain != c){
+                            (void) fprintf(stderr, "codebook: codeword \"%s\" used for two symbols\n", word);
+                            freeCodebook(book);
+                            return NULL;
+                        }
+                        continue;
+                    }
+                    collision = 1;
+                    continue;
+                }
+
+                //Codeword text of the first span with this word
+                for(size_t j = book->symbols[c].first; j < book->symbols[c].first + book->symbols[c].count; j++){
+                    if(spans[j].length == length + 1 && memcmp(&text[spans[j].offset], word, length) == 0){
+                        slot->offset = spans[j].offset;
+                        break;
+                    }
+                }
+
+                slot->key = key;
+                slot->length = (uint32_t) length;
+                slot->plain = c;
+            }
+
+            if(!collision){
+                return book;
+            }
+        }
+
+        (void) munmap(book, size);
+    }
+
+    (void) fprintf(stderr, "codebook: could not build decode table\n");
+    return NULL;
+}
+
+struct codebook *loadCodebook(const char *path)
+{
+    struct codebook *book;
+    struct stat st;
+    char magic[sizeof(((struct codebook *) 0)->magic)];
+    char *cachepath;
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0){
+        (void) fprintf(stderr, "codebook: %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    n = read(fd, magic, sizeof(magic));
+    if(fstat(fd, &st) < 0){
+        n = -1;
+    }
+    (void) close(fd);
+
+    if(n == (ssize_t) sizeof(magic) && memcmp(magic, CODEBOOK_MAGIC, sizeof(magic)) == 0){
+        return mapCodebook(path);
+    }
+
+    cachepath = malloc(strlen(path) + sizeof(".bin"));
+    if(cachepath == NULL){
+        return NULL;
+    }
+    (void) strcpy(cachepath, path);
+    (void) strcat(cachepath, ".bin");
+
+    //Cache of the text codebook
+    book = mapCodebook(cachepath);
+    if(book != NULL){
+        if(book->sourcesize == (uint64_t) st.st_size && book->sourcetime == (int64_t) st.st_mtime){
+            free(cachepath);
+            return book;
+        }
+        freeCodebook(book);
+    }
+
+    book = parseCodebook(path);
+    if(book != NULL){
+        book->sourcesize = (uint64_t) st.st_size;
+        book->sourcetime = (int64_t) st.st_mtime;
+
+        //The cache is optional, the directory might not be writable
+        (void) saveCodebook(book, cachepath);
+    }
+
+    free(cachepath);
+    return book;
+}
+
+int saveCodebook(const struct codebook *book, const char *path)
+{
+    char *tmppath = malloc(strlen(path) + 32);
+    const char *data = (const char *) book;
+    size_t left = book->size;
+    int fd;
+
+    if(tmppath == NULL){
+        return -1;
+    }
+    (void) sprintf(tmppath, "%s.%ld.tmp", path, (long) getpid());
+
+    fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        free(tmppath);
+        return -1;
+    }
+
+    while(left > 0){
+        ssize_t s = write(fd, data, left);
+
+        if(s < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        data += s;
+        left -= (size_t) s;
+    }
+
+    if(close(fd) < 0 || left > 0 || rename(tmppath, path) < 0){
+        (void) unlink(tmppath);
+        free(tmppath);
+        return -1;
+    }
+
+    free(tmppath);
+    return 0;
+}
+
+void freeCodebook(struct codebook *book)
+{
+    if(book != NULL){
+        (void) munmap(book, book->size);
+    }
+}
+
+uint64_t codebookKey(const char *word, size_t length)
+{
+    uint64_t key = 0;
+
+    for(size_t i = 0; i < length && i < 8; i++){
+        key |= (uint64_t) (unsigned char) word[i] << (8 * i);
+    }
+
+    return key;
+}
+
+uint64_t codebookChecksum(const struct codebook *book)
+{
+    const unsigned char *data = (const unsigned char *) book->symbols;
+    const size_t length = book->size - offsetof(struct codebook, symbols);
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for(size_t i = 0; i < length; i++){
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Maps a compiled codebook
+ * @param path the file
+ * @return the codebook or NULL if the file does not exist or is no valid compiled codebook
+ */
+static struct codebook *mapCodebook(const char *path)
+{
+    struct codebook *book;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0){
+        return NULL;
+    }
+
+    if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct codebook)){
+        (void) close(fd);
+        return NULL;
+    }
+
+    book = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void) close(fd);
+    if(book == MAP_FAILED){
+        return NULL;
+    }
+
+    if(checkCodebook(book, (size_t) st.st_size) < 0){
+        (void) fprintf(stderr, "codebook: %s is damaged\n", path);
+        (void) munmap(book, (size_t) st.st_size);
+        return NULL;
+    }
+
+    return book;
+}
+
+/**
+ * @brief Validates a mapped codebook
+ * @param book the codebook
+ * @param size size of the mapping
+ * @return 0 if all offsets stay within the mapping, -1 else
+ */
+static int checkCodebook(const struct codebook *book, size_t size)
+{
+    const struct cbSpan *spans = codebookSpans(book);
+    const struct cbSlot *slots = codebookSlots(book);
+    size_t textsize;
+
+    if(memcmp(book->magic, CODEBOOK_MAGIC, sizeof(book->magic)) != 0 || book->version != CODEBOOK_VERSION ||
+       book->size != size || book->tablebits < 1 || book->tablebits > MAXTABLEBITS || book->nspans < 1 ||
+       book->spansoffset < sizeof(struct codebook) ||
+       book->slotsoffset < book->spansoffset + (size_t) book->nspans * sizeof(struct cbSpan) ||
+       book->textoffset < book->slotsoffset + ((size_t) 1 << book->tablebits) * sizeof(struct cbSlot) ||
+       book->textoffset + CODEBOOK_SLACK > size || book->spansoffset % 8 != 0 || book->slotsoffset % 8 != 0){
+        return -1;
+    }
+
+    textsize = size - book->textoffset - CODEBOOK_SLACK;
+
+    for(size_t i = 0; i < book->nspans; i++){
+        if(spans[i].length == 0 || spans[i].length > book->maxspan ||
+           (size_t) spans[i].offset + spans[i].length > textsize){
+            return -1;
+        }
+    }
+
+    for(int c = 0; c < 256; c++){
+        if((size_t) book->symbols[c].first + book->symbols[c].count > book->nspans){
+            return -1;
+        }
+    }
+
+    for(size_t i = 0; i < ((size_t) 1 << book->tablebits); i++){
+        if(slots[i].length > CODEBOOK_MAXWORD || (size_t) slots[i].offset + slots[i].length > textsize){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Parses and compiles a text codebook
+ * @param path the file
+ * @return the compiled codebook or NULL on error
+ */
+static struct codebook *parseCodebook(const char *path)
+{
+    struct codebook *book = NULL;
+    struct codebookEntry *entries = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t length = 0;
+    char *content = NULL;
+    char *line;
+    int lineno = 0;
+    FILE *f = fopen(path, "r");
+
+    if(f == NULL){
+        (void) fprintf(stderr, "codebook: %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    //Whole file, words point into it
+    for(;;){
+        char *grown = realloc(content, length + 4096 + 1);
+        size_t n;
+
+        if(grown == NULL){
+            goto out;
+        }
+        content = grown;
+
+        n = fread(&content[length], 1, 4096, f);
+        length += n;
+        if(n < 4096){
+            break;
+        }
+    }
+    if(ferror(f)){
+        (void) fprintf(stderr, "codebook: %s: read error\n", path);
+        goto out;
+    }
+    content[length] = '\0';
+
+    for(line = content; line != NULL && *line != '\0'; ){
+        char *next = strchr(line, '\n');
+        char *token;
+        unsigned char symbol;
+        int words = 0;
+
+        if(next != NULL){
+            *next++ = '\0';
+        }
+        lineno++;
+
+        token = strtok(line, " \t\r");
+        if(token == NULL || token[0] == '#'){
+            line = next;
+            continue;
+        }
+
+        if(parseSymbol(token, &symbol) < 0){
+            (void) fprintf(stderr, "codebook: %s:%d: bad symbol \"%s\"\n", path, lineno, token);
+            goto out;
+        }
+
+        while((token = strtok(NULL, " \t\r")) != NULL){
+            if(count == capacity){
+                struct codebookEntry *grown;
+
+                capacity = capacity == 0 ? 64 : 2 * capacity;
+                grown = realloc(entries, capacity * sizeof(struct codebookEntry));
+                if(grown == NULL){
+                    goto out;
+                }
+                entries = grown;
+            }
+
+            entries[count].symbol = symbol;
+            entries[count].word = token;
+            count++;
+            words++;
+        }
+
+        if(words == 0){
+            (void) fprintf(stderr, "codebook: %s:%d: symbol without codeword\n", path, lineno);
+            goto out;
+        }
+
+        line = next;
+    }
+
+    book = compileCodebook(entries, count);
+
+out:
+    (void) fclose(f);
+    free(entries);
+    free(content);
+    return book;
+}
+
+/**
+ * @brief Parses the symbol of a codebook line
+ * @param token the symbol as written in the file
+ * @param symbol the parsed byte
+ * @return 0 on success, -1 else
+ */
+static int parseSymbol(const char *token, unsigned char *symbol)
+{
+    char *endptr;
+    long value;
+
+    if(token[0] != '\\' && token[1] == '\0'){
+        *symbol = (unsigned char) token[0];
+        return 0;
+    }
+
+    if(strcmp(token, "\\s") == 0){
+        *symbol = ' ';
+        return 0;
+    }
+
+    if(strcmp(token, "\\\\") == 0){
+        *symbol = '\\';
+        return 0;
+    }
+
+    if(token[0] == '\\' && token[1] == 'x' && isxdigit((unsigned char) token[2])){
+        value = strtol(&token[2], &endptr, 16);
+        if(*endptr == '\0' && value >= 0 && value <= 255){
+            *symbol = (unsigned char) value;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Checks for the characters separating codewords
+ * @param c the character
+ * @return 1 for space, dot and newline, 0 else
+ */
+static int isDelimiter(char c)
+{
+    return c == ' ' || c == '.' || c == '\n';
+}
@@ -0,0 +1,168 @@
+/**
+ * @file    codebook.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Compiled codebooks for stegit
+ * @details A codebook maps plain bytes to codewords and back. The compiled form is a single position
+ * independent block of memory: a header followed by the encode table, the codeword spans, the decode hash
+ * table and the codeword text. It can be written to a file as is and memory mapped again later.
+ *
+ * Text codebooks contain one symbol per line: the symbol followed by one or more codewords separated by
+ * blanks, several codewords are synonyms. Empty lines and lines starting with '#' are ignored. The symbol is
+ * a single character, "\s" for space, "\\" for backslash or "\xHH" for any other byte. An entry for a letter
+ * also covers the other case of the letter unless that one has an entry of its own.
+ */
+
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CODEBOOK_MAGIC ("STEGCB1")
+#define CODEBOOK_VERSION (1)
+#define CODEBOOK_MAXWORD (64)       /**< longest codeword */
+#define CODEBOOK_SLACK (16)         /**< readable bytes after every span, see encodeWith() in libstegit.c */
+
+/**
+ * @brief entry of the encode table
+ * @details the synonyms of a byte are the spans first..first+count-1, count is 0 for the bytes handled by the
+ * encoder itself ('\n', '\0' and 0xff). Bytes without codeword use span 0, which is a single space.
+ */
+struct cbSymbol {
+    uint32_t first;
+    uint32_t count;
+};
+
+/**
+ * @brief codeword followed by a space
+ */
+struct cbSpan {
+    uint32_t offset;        /**< offset in the text */
+    uint32_t length;        /**< including the space */
+};
+
+/**
+ * @brief slot of the decode hash table, empty if length is 0
+ */
+struct cbSlot {
+    uint64_t key;           /**< first eight bytes of the codeword, see codebookKey() */
+    uint32_t offset;        /**< offset of the codeword in the text */
+    uint32_t length;        /**< length of the codeword */
+    uint32_t plain;         /**< decoded byte */
+    uint32_t pad;
+};
+
+/**
+ * @brief header of a compiled codebook, all offsets are relative to its start
+ */
+struct codebook {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;          /**< size of the whole compiled codebook in bytes */
+    uint64_t sourcesize;    /**< size of the text codebook it was compiled from */
+    int64_t sourcetime;     /**< modification time of the text codebook */
+    uint64_t multiplier;    /**< multiplier of the decode hash */
+    uint32_t tablebits;     /**< the decode table has 1 << tablebits slots */
+    uint32_t nspans;
+    uint32_t maxspan;       /**< longest span */
+    uint32_t spansoffset;
+    uint32_t slotsoffset;
+    uint32_t textoffset;
+    struct cbSymbol symbols[256];
+};
+
+/**
+ * @brief codeword of a symbol, input of compileCodebook()
+ */
+struct codebookEntry {
+    unsigned char symbol;
+    const char *word;
+};
+
+/**
+ * @brief Compiles a list of codewords
+ * @param entries the codewords, synonyms of a symbol in the order they should be used
+ * @param count number of entries
+ * @return the compiled codebook, to be released with freeCodebook(), or NULL if the entries are invalid
+ */
+struct codebook *compileCodebook(const struct codebookEntry *entries, size_t count);
+
+/**
+ * @brief Loads a codebook
+ * @details Compiled codebooks are memory mapped. Text codebooks are compiled and the result is cached in
+ * "<path>.bin", which is mapped instead as long as the size and modification time recorded in it equal those of
+ * the text.
+ * @param path path of a text or compiled codebook
+ * @return the codebook, to be released with freeCodebook(), NULL on error
+ */
+struct codebook *loadCodebook(const char *path);
+
+/**
+ * @brief Writes a compiled codebook to a file
+ * @param book the codebook
+ * @param path the file, replaced atomically
+ * @return 0 on success, -1 else
+ */
+int saveCodebook(const struct codebook *book, const char *path);
+
+/**
+ * @brief Releases a codebook returned by compileCodebook() or loadCodebook()
+ * @param book the codebook, may be NULL
+ */
+void freeCodebook(struct codebook *book);
+
+/**
+ * @brief Key of a codeword for the decode hash table
+ * @param word start of the word
+ * @param length length of the word
+ * @return byte i of the word in bits 8i..8i+7 for the first eight bytes, missing bytes are zero
+ */
+uint64_t codebookKey(const char *word, size_t length);
+
+/**
+ * @brief Checksum of the tables of a codebook
+ * @details FNV-1a over everything after the header fields, equal for all compilations of the same codewords
+ * @param book the codebook
+ * @return the checksum
+ */
+uint64_t codebookChecksum(const struct codebook *book);
+
+/**
+ * @brief Slot index of a word in the decode hash table
+ * @param book the codebook
+ * @param key key of the word, see codebookKey()
+ * @param word start of the word
+ * @param length length of the word
+ * @return slot index
+ */
+static inline uint32_t codebookHash(const struct codebook *book, uint64_t key, const char *word, size_t length)
+{
+    uint64_t hash = (key ^ length) * book->multiplier;
+
+    for(size_t i = 8; i < length; i++){
+        hash = (hash ^ (unsigned char) word[i]) * book->multiplier;
+    }
+
+    return (uint32_t) (hash >> (64 - book->tablebits));
+}
+
+/** @brief The span array of a codebook */
+static inline const struct cbSpan *codebookSpans(const struct codebook *book)
+{
+    return (const struct cbSpan *) ((const char *) book + book->spansoffset);
+}
+
+/** @brief The decode hash table of a codebook */
+static inline const struct cbSlot *codebookSlots(const struct codebook *book)
+{
+    return (const struct cbSlot *) ((const char *) book + book->slotsoffset);
+}
+
+/** @brief The codeword text of a codebook */
+static inline const char *codebookText(const struct codebook *book)
+{
+    return (const char *) book + book->textoffset;
+}
+
+#endif /* CODEBOOK_H */
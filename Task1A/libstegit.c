@@ -0,0 +1,707 @@
+/**
+ * @file    libstegit.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the stegit library
+ */
+
+#include "libstegit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SPANLENGTH (CODEBOOK_SLACK)     /* bytes copied at once for short spans */
+
+/**
+ * @brief reading position in packed idx codes
+ */
+struct unpacker {
+    const unsigned char *next;
+    uint64_t bits;                  /* bits read but not used yet */
+    unsigned nbits;
+};
+
+static void compileDefault(void);
+static inline size_t encodeWith(struct stegit *ctx, const char *in, size_t length, char *out, int idx)
+    __attribute__((always_inline));
+static uint32_t unpackCode(struct unpacker *unpacker, unsigned bits);
+static int drawDot(struct stegit *ctx);
+static uint32_t drawSynonym(struct stegit *ctx, uint32_t count);
+static uint64_t nextRandom(uint64_t *state);
+static uint64_t delimiterMask(const char *data);
+static char decodeKey(const struct codebook *book, uint64_t key, const char *word, size_t length);
+static char decodeAt(const struct codebook *book, const char *data, size_t start, size_t end, size_t length);
+static void carryWord(struct stegit *ctx, const char *word, size_t length);
+
+/* Words of the default codebook, library users reach them through stegitDefaultCodebook() */
+static const char *const chiffre[28] = {
+        "die", "sonne", "der", "das", "um",
+        "neun", "Uhr", "aufgeht", "blumme", "baum",
+        "Alice", "Bob", "schauen", "schlafen", "und",
+        "darum", "deshalb", "Stein", "Baum", "blau", "gelb",
+        "groß", "klein", "Fahne", "stehen",
+        "zehn", "Mond", "Ende"
+};
+
+/* Compiled chiffre array, see stegitDefaultCodebook() */
+static struct codebook *defaultBook;
+static pthread_once_t defaultOnce = PTHREAD_ONCE_INIT;
+
+void stegitInit(struct stegit *ctx, const struct codebook *book)
+{
+    ctx->book = book != NULL ? book : stegitDefaultCodebook();
+    ctx->seeded = 0;
+    ctx->rng = 0;
+    ctx->counters.symbols = 0;
+    ctx->counters.dropped = 0;
+    ctx->counters.unknown = 0;
+    stegitReset(ctx);
+}
+
+void stegitSeed(struct stegit *ctx, uint64_t seed)
+{
+    ctx->seeded = 1;
+    ctx->rng = seed;
+}
+
+void stegitReset(struct stegit *ctx)
+{
+    ctx->chunkleft = STEGIT_CHUNKLENGTH;
+    ctx->dotcount = 0;
+    ctx->skipping = 0;
+    ctx->end = 0;
+    ctx->carrylength = 0;
+}
+
+size_t stegitEncodeBound(const struct stegit *ctx, size_t length)
+{
+    return length * (ctx->book->maxspan + 1) + SPANLENGTH;
+}
+
+size_t stegitEncode(struct stegit *ctx, const char *in, size_t length, char *out)
+{
+    return encodeWith(ctx, in, length, out, 0);
+}
+
+unsigned stegitIdxBits(const struct stegit *ctx)
+{
+    unsigned bits = 1;
+
+    //Span indices 0..nspans and the dot bit
+    while(((uint64_t) 1 << bits) <= ctx->book->nspans){
+        bits++;
+    }
+
+    return bits + 1;
+}
+
+void stegitIdxHeader(const struct stegit *ctx, struct stegitIdxHeader *header)
+{
+    (void) memset(header, 0, sizeof(*header));
+    (void) memcpy(header->magic, STEGIT_IDXMAGIC, sizeof(STEGIT_IDXMAGIC));
+    header->version = STEGIT_IDXVERSION;
+    header->bits = stegitIdxBits(ctx);
+    header->checksum = codebookChecksum(ctx->book);
+}
+
+int stegitIdxCheck(const struct stegit *ctx, const struct stegitIdxHeader *header)
+{
+    if(memcmp(header->magic, STEGIT_IDXMAGIC, sizeof(STEGIT_IDXMAGIC)) != 0 ||
+       header->version != STEGIT_IDXVERSION ||
+       header->bits != stegitIdxBits(ctx) ||
+       header->checksum != codebookChecksum(ctx->book)){
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t stegitIdxPackedSize(const struct stegit *ctx, uint32_t count)
+{
+    return ((size_t) count * stegitIdxBits(ctx) + 7) / 8;
+}
+
+size_t stegitIdxBound(const struct stegit *ctx, size_t length)
+{
+    return STEGIT_IDXCOUNTSIZE + (length * stegitIdxBits(ctx) + 7) / 8;
+}
+
+size_t stegitEncodeIdx(struct stegit *ctx, const char *in, size_t length, char *out)
+{
+    return encodeWith(ctx, in, length, out, 1);
+}
+
+size_t stegitRenderIdx(const struct stegit *ctx, const char *packed, uint32_t count, char *out)
+{
+    const struct cbSpan *spans = codebookSpans(ctx->book);
+    const char *text = codebookText(ctx->book);
+    const uint32_t nspans = ctx->book->nspans;
+    const unsigned bits = stegitIdxBits(ctx);
+    struct unpacker unpacker = { (const unsigned char *) packed, 0, 0 };
+    size_t outlength = 0;
+
+    for(uint32_t i = 0; i < count; i++){
+        const uint32_t code = unpackCode(&unpacker, bits);
+        const struct cbSpan *span = &spans[code >> 1 < nspans ? code >> 1 : 0];
+
+        if(code >> 1 == nspans){
+            out[outlength++] = '\n';
+            continue;
+        }
+
+        //Out of range, an empty word
+        if(code >> 1 > nspans){
+            out[outlength++] = ' ';
+            continue;
+        }
+
+        (void) memcpy(&out[outlength], &text[span->offset], span->length <= SPANLENGTH ? SPANLENGTH : span->length);
+        outlength += span->length;
+
+        if(code & 1){
+            out[outlength - 1] = '.';
+            out[outlength++] = ' ';
+        }
+    }
+
+    return outlength;
+}
+
+size_t stegitDecodeIdx(struct stegit *ctx, const char *packed, uint32_t count, char *out)
+{
+    const struct cbSpan *spans = codebookSpans(ctx->book);
+    const char *text = codebookText(ctx->book);
+    const uint32_t nspans = ctx->book->nspans;
+    const unsigned bits = stegitIdxBits(ctx);
+    struct unpacker unpacker = { (const unsigned char *) packed, 0, 0 };
+    size_t outlength = 0;
+    uint64_t unknown = 0;
+
+    for(uint32_t i = 0; i < count; i++){
+        const uint32_t span = unpackCode(&unpacker, bits) >> 1;
+
+        if(span > nspans){
+            unknown++;
+        }else if(span < nspans && spans[span].length > 1){
+            out[outlength] = stegitDecodeWord(ctx, &text[spans[span].offset], spans[span].length - 1);
+            unknown += out[outlength++] == '\0';
+        }
+    }
+
+    ctx->counters.unknown += unknown;
+    return outlength;
+}
+
+size_t stegitScan(struct stegit *ctx, const char *in, size_t length)
+{
+    for(size_t i = 0; i < length && !ctx->end; i++){
+        const unsigned char c = (unsigned char) in[i];
+
+        if(ctx->skipping){
+            if(c == '\n' || --ctx->chunkleft == 0){
+                ctx->skipping = 0;
+                ctx->chunkleft = STEGIT_CHUNKLENGTH;
+            }
+            continue;
+        }
+
+        if(ctx->book->symbols[c].count == 0 && c != '\0'){
+            ctx->end = 1;
+            return i + 1;
+        }
+
+        if(--ctx->chunkleft == 0){
+            ctx->chunkleft = STEGIT_CHUNKLENGTH;
+        }else if(c == '\0'){
+            ctx->skipping = 1;
+        }
+    }
+
+    return ctx->end ? 0 : length;
+}
+
+size_t stegitDecode(struct stegit *ctx, const char *in, size_t length, char *out)
+{
+    const struct codebook *book = ctx->book;
+    size_t outlength = 0;
+    size_t start = 0;
+    size_t base;
+    uint64_t unknown = 0;
+
+    //Complete the carried word
+    if(ctx->carrylength > 0){
+        while(start < length && in[start] != ' ' && in[start] != '.' && in[start] != '\n'){
+            start++;
+        }
+
+        carryWord(ctx, in, start);
+        if(start == length){
+            return 0;
+        }
+
+        outlength += stegitFinish(ctx, out);
+        start++;
+    }
+
+    for(base = start; base + 64 <= length; base += 64){
+        uint64_t mask = delimiterMask(&in[base]);
+
+        while(mask != 0){
+            const size_t i = base + (size_t) __builtin_ctzll(mask);
+            mask &= mask - 1;
+
+            if(i > start){
+                out[outlength] = decodeAt(book, in, start, i, length);
+                unknown += out[outlength++] == '\0';
+            }
+            start = i + 1;
+        }
+    }
+
+    for(size_t i = base; i < length; i++){
+
+        if(in[i] != ' ' && in[i] != '.' && in[i] != '\n'){
+            continue;
+        }
+
+        if(i > start){
+            out[outlength] = decodeAt(book, in, start, i, length);
+            unknown += out[outlength++] == '\0';
+        }
+        start = i + 1;
+    }
+
+    carryWord(ctx, &in[start], length - start);
+    ctx->counters.unknown += unknown;
+
+    return outlength;
+}
+
+size_t stegitFinish(struct stegit *ctx, char *out)
+{
+    if(ctx->carrylength == 0){
+        return 0;
+    }
+
+    out[0] = stegitDecodeWord(ctx, ctx->carry, ctx->carrylength);
+    ctx->counters.unknown += out[0] == '\0';
+    ctx->carrylength = 0;
+    return 1;
+}
+
+char stegitDecodeWord(const struct stegit *ctx, const char *word, size_t length)
+{
+    if(length > CODEBOOK_MAXWORD){
+        return '\0';
+    }
+
+    return decodeKey(ctx->book, codebookKey(word, length), word, length);
+}
+
+void stegitIndexInit(struct stegitIndexer *indexer, uint32_t interval)
+{
+    indexer->interval = interval;
+    indexer->inword = 0;
+    indexer->offset = 0;
+    indexer->words = 0;
+}
+
+size_t stegitIndexScan(struct stegitIndexer *indexer, const char *in, size_t length, uint64_t *entries)
+{
+    size_t count = 0;
+    int inword = indexer->inword;
+
+    for(size_t i = 0; i < length; i++){
+
+        if(in[i] == ' ' || in[i] == '.' || in[i] == '\n'){
+            inword = 0;
+            continue;
+        }
+
+        if(!inword){
+            if(indexer->words % indexer->interval == 0){
+                entries[count++] = indexer->offset + i;
+            }
+            indexer->words++;
+            inword = 1;
+        }
+    }
+
+    indexer->inword = inword;
+    indexer->offset += length;
+
+    return count;
+}
+
+const struct codebook *stegitDefaultCodebook(void)
+{
+    (void) pthread_once(&defaultOnce, compileDefault);
+    return defaultBook;
+}
+
+const char *encryptChar(char plain)
+{
+    //ASCII Table under https://www.uni-due.de/hummell/infos/ascii/
+
+    //Dot
+    if(plain == 46){
+        return chiffre[27];
+    }
+
+    //Space
+    if(plain == 32){
+        return chiffre[26];
+    }
+
+    //Upper char
+    if(plain >= 65 && plain <= 90){
+        return chiffre[plain-65];
+    }
+
+    //Lower char
+    if(plain >= 97 && plain <= 122){
+        return chiffre[plain - 97];
+    }
+
+    //any other char
+    return "";
+}
+
+const char decryptChar(char *chiffreChar)
+{
+    struct stegit ctx;
+    size_t length = 0;
+
+    while(chiffreChar[length] != '\0'){
+        length++;
+    }
+
+    stegitInit(&ctx, NULL);
+    return stegitDecodeWord(&ctx, chiffreChar, length);
+}
+
+/**
+ * @brief Compiles the chiffre array into defaultBook
+ * @details maps the words to the same bytes as encryptChar()
+ */
+static void compileDefault(void)
+{
+    struct codebookEntry entries[28];
+
+    for(int i = 0; i < 28; i++){
+        entries[i].word = chiffre[i];
+
+        if(i == 27){
+            entries[i].symbol = '.';
+        }else if(i == 26){
+            entries[i].symbol = ' ';
+        }else{
+            entries[i].symbol = (unsigned char) (i + 97);
+        }
+    }
+
+    defaultBook = compileCodebook(entries, 28);
+}
+
+/**
+ * @brief Encodes plain text into words or idx codes
+ * @param ctx the context
+ * @param in the plain text
+ * @param length length of the plain text
+ * @param out the output buffer
+ * @param idx 0 for the text form, 1 for an idx block
+ * @return number of bytes written to out
+ * @details inlined into stegitEncode() and stegitEncodeIdx(), so the test of idx costs nothing
+ */
+static inline size_t encodeWith(struct stegit *ctx, const char *in, size_t length, char *out, int idx)
+{
+    const struct cbSymbol *symbols = ctx->book->symbols;
+    const struct cbSpan *spans = codebookSpans(ctx->book);
+    const char *text = codebookText(ctx->book);
+    const unsigned bits = idx ? stegitIdxBits(ctx) : 0;
+    size_t outlength = idx ? STEGIT_IDXCOUNTSIZE : 0;
+    size_t chunkleft = ctx->chunkleft;
+    int dotcount = ctx->dotcount;
+    int skipping = ctx->skipping;
+    uint32_t count = 0;
+    uint64_t pending = 0;
+    unsigned npending = 0;
+    uint64_t encoded = 0;
+    uint64_t dropped = 0;
+    int end = ctx->end;
+
+    for(size_t i = 0; i < length && !end; i++){
+        const unsigned char c = (unsigned char) in[i];
+        const struct cbSymbol *symbol = &symbols[c];
+        const struct cbSpan *span;
+        uint32_t code;
+
+        //Rest of a chunk after '\0'
+        if(skipping){
+            if(c == '\n' || --chunkleft == 0){
+                skipping = 0;
+                chunkleft = STEGIT_CHUNKLENGTH;
+            }
+            continue;
+        }
+
+        if(symbol->count == 0){
+            if(c == '\0'){
+                if(--chunkleft == 0){
+                    chunkleft = STEGIT_CHUNKLENGTH;
+                }else{
+                    skipping = 1;
+                }
+                continue;
+            }
+
+            //Newline or EOF
+            end = 1;
+            if(!idx){
+                out[outlength++] = '\n';
+                break;
+            }
+            code = ctx->book->nspans << 1;
+        }else{
+            //Encrypted character and space after word
+            span = &spans[symbol->first];
+            encoded++;
+            dropped += symbol->first == 0;
+            if(symbol->count > 1){
+                span += drawSynonym(ctx, symbol->count);
+            }
+
+            if(!idx){
+                if(span->length <= SPANLENGTH){
+                    (void) memcpy(&out[outlength], &text[span->offset], SPANLENGTH);
+                }else{
+                    (void) memcpy(&out[outlength], &text[span->offset], span->length);
+                }
+                outlength += span->length;
+            }
+            code = (uint32_t) (span - spans) << 1;
+
+            //Dot, placed between word and space
+            if(dotcount >= 5 && dotcount <= 15){
+                if(drawDot(ctx) || dotcount == 15){
+                    if(!idx){
+                        out[outlength - 1] = '.';
+                        out[outlength++] = ' ';
+                    }
+                    code |= 1;
+                    dotcount = 0;
+                }
+            }
+
+            dotcount++;
+
+            if(--chunkleft == 0){
+                chunkleft = STEGIT_CHUNKLENGTH;
+            }
+        }
+
+        if(idx){
+            pending |= (uint64_t) code << npending;
+            for(npending += bits; npending >= 8; npending -= 8){
+                out[outlength++] = (char) (unsigned char) pending;
+                pending >>= 8;
+            }
+            count++;
+        }
+    }
+
+    if(idx){
+        if(npending > 0){
+            out[outlength++] = (char) (unsigned char) pending;
+        }
+        (void) memcpy(out, &count, STEGIT_IDXCOUNTSIZE);
+    }
+
+    ctx->chunkleft = chunkleft;
+    ctx->dotcount = dotcount;
+    ctx->skipping = skipping;
+    ctx->end = end;
+    ctx->counters.symbols += encoded - dropped;
+    ctx->counters.dropped += dropped;
+
+    return outlength;
+}
+
+/**
+ * @brief Reads the next code of an idx block
+ * @param unpacker the reading position
+ * @param bits bits per code
+ * @return the code
+ */
+static uint32_t unpackCode(struct unpacker *unpacker, unsigned bits)
+{
+    uint32_t code;
+
+    while(unpacker->nbits < bits){
+        unpacker->bits |= (uint64_t) *unpacker->next++ << unpacker->nbits;
+        unpacker->nbits += 8;
+    }
+
+    code = (uint32_t) (unpacker->bits & (((uint64_t) 1 << bits) - 1));
+    unpacker->bits >>= bits;
+    unpacker->nbits -= bits;
+
+    return code;
+}
+
+/**
+ * @brief Decides whether a dot may follow the current word
+ * @param ctx the context
+ * @return 1 with probability 1/3
+ * @details seeded contexts use their own splitmix64 stream, the others rand() like the original encoder
+ */
+static int drawDot(struct stegit *ctx)
+{
+    if(ctx->seeded){
+        return (uint32_t) (nextRandom(&ctx->rng) >> 32) % 3 == 0;
+    }
+
+    return rand() % 3 == 0;
+}
+
+/**
+ * @brief Selects one of the synonyms of a byte
+ * @param ctx the context
+ * @param count number of synonyms
+ * @return index of the synonym to use
+ */
+static uint32_t drawSynonym(struct stegit *ctx, uint32_t count)
+{
+    if(ctx->seeded){
+        return (uint32_t) (nextRandom(&ctx->rng) >> 32) % count;
+    }
+
+    return (uint32_t) rand() % count;
+}
+
+/**
+ * @brief splitmix64 step
+ * @param state the generator state
+ * @return next pseudo random number
+ */
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Finds the delimiters in 64 bytes
+ * @param data start of the 64 bytes
+ * @return bit i is set if data[i] is a space, dot or newline
+ */
+static uint64_t delimiterMask(const char *data)
+{
+    uint64_t mask = 0;
+
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i dot = _mm_set1_epi8('.');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for(int i = 0; i < 64; i += 16){
+        const __m128i chunk = _mm_loadu_si128((const __m128i *) &data[i]);
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, dot)),
+                                         _mm_cmpeq_epi8(chunk, newline));
+
+        mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(hit) << i;
+    }
+#else
+    for(int i = 0; i < 64; i++){
+        if(data[i] == ' ' || data[i] == '.' || data[i] == '\n'){
+            mask |= (uint64_t) 1 << i;
+        }
+    }
+#endif
+
+    return mask;
+}
+
+/**
+ * @brief Looks up a word with a precomputed key in the decode table
+ * @param book the codebook
+ * @param key key of the word, see codebookKey()
+ * @param word start of the word
+ * @param length length of the word
+ * @return plain character, '\0' if the word is no codeword
+ * @details one hash computation and one key comparison, bytes beyond the first eight are compared one by one
+ */
+static char decodeKey(const struct codebook *book, uint64_t key, const char *word, size_t length)
+{
+    const struct cbSlot *slot = &codebookSlots(book)[codebookHash(book, key, word, length)];
+    const char *text = codebookText(book) + slot->offset;
+
+    if(slot->key != key || slot->length != length){
+        return '\0';
+    }
+
+    for(size_t i = 8; i < length; i++){
+        if(text[i] != word[i]){
+            return '\0';
+        }
+    }
+
+    return (char) slot->plain;
+}
+
+/**
+ * @brief Decodes the word data[start..end)
+ * @param book the codebook
+ * @param data the input
+ * @param start start of the word
+ * @param end end of the word
+ * @param length length of the input
+ * @return plain character, '\0' if the word is no codeword
+ * @details loads the key with a single eight byte read if the input is long enough
+ */
+static char decodeAt(const struct codebook *book, const char *data, size_t start, size_t end, size_t length)
+{
+    const size_t wordlength = end - start;
+
+    if(wordlength > CODEBOOK_MAXWORD){
+        return '\0';
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(start + 8 <= length){
+        uint64_t key;
+
+        (void) memcpy(&key, &data[start], 8);
+        if(wordlength < 8){
+            key &= ((uint64_t) 1 << (8 * wordlength)) - 1;
+        }
+
+        return decodeKey(book, key, &data[start], wordlength);
+    }
+#endif
+
+    return decodeKey(book, codebookKey(&data[start], wordlength), &data[start], wordlength);
+}
+
+/**
+ * @brief Appends bytes to the carried word
+ * @param ctx the context
+ * @param word bytes to append
+ * @param length number of bytes
+ */
+static void carryWord(struct stegit *ctx, const char *word, size_t length)
+{
+    if(ctx->carrylength < CODEBOOK_MAXWORD){
+        const size_t space = CODEBOOK_MAXWORD - ctx->carrylength;
+        (void) memcpy(&ctx->carry[ctx->carrylength], word, length < space ? length : space);
+    }
+
+    ctx->carrylength += length;
+}
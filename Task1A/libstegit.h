@@ -0,0 +1,289 @@
+/**
+ * @file    libstegit.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Buffer to buffer interface of stegit
+ * @details Hides plain text in a sequence of codewords and finds it again without any I/O. All state of a
+ * message lives in a struct stegit, which can be reused for any number of messages and does not allocate
+ * memory. Input may be passed in pieces of any size: a word split between two calls of stegitDecode() is
+ * carried over, and the encoder continues exactly where the last call stopped.
+ *
+ * Hide mode ends the message at the first newline, like the original program did.
+ *
+ * Besides the text form, hidden messages can be stored in the idx form: a struct stegitIdxHeader followed by
+ * blocks of a 32 bit code count and the codes packed LSB first into stegitIdxBits() bits each. A code is the
+ * index of the codeword span shifted left by one, bit 0 is set if a dot follows the word. The span index
+ * nspans stands for the final newline. Rendering the codes gives exactly the text form.
+ *
+ * A seek index of a text form file is a struct stegitIndexHeader followed by the offset of every interval-th
+ * word as 64 bit integers. Since find mode writes one byte per word, entry i is the position in the hidden text
+ * where the decoding of plain text byte i * interval starts.
+ */
+
+#ifndef LIBSTEGIT_H
+#define LIBSTEGIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "codebook.h"
+
+#define STEGIT_CHUNKLENGTH (299)    /**< bytes one fgets() call delivered to the original encoder */
+#define STEGIT_IDXMAGIC ("STEGIX1")
+#define STEGIT_IDXVERSION (1)
+#define STEGIT_IDXCOUNTSIZE (4)     /**< bytes of the code count in front of every idx block */
+#define STEGIT_INDEXMAGIC ("STEGSX1")
+#define STEGIT_INDEXVERSION (1)
+
+/**
+ * @brief counters of a context
+ * @details they only grow, the caller may read and clear them at any time
+ */
+struct stegitCounters {
+    uint64_t symbols;               /**< encoder: bytes replaced by a codeword */
+    uint64_t dropped;               /**< encoder: bytes without codeword, written as a single space */
+    uint64_t unknown;               /**< decoder: words which are no codeword */
+};
+
+/**
+ * @brief context of a message
+ * @details The members are public so that a context can live on the stack or inside other structures and be
+ * copied, they should only be changed through the functions below.
+ */
+struct stegit {
+    const struct codebook *book;    /**< tables, shared between contexts */
+
+    size_t chunkleft;               /**< encoder: bytes left in the current fgets() chunk */
+    int dotcount;                   /**< encoder: words since the last dot */
+    int skipping;                   /**< encoder: skipping the rest of a chunk after '\0' */
+    int end;                        /**< encoder: the message ended */
+    int seeded;                     /**< dots and synonyms are drawn from rng instead of rand() */
+    uint64_t rng;                   /**< splitmix64 state */
+
+    char carry[CODEBOOK_MAXWORD];   /**< decoder: start of a word cut by the end of the input */
+    size_t carrylength;             /**< decoder: may exceed CODEBOOK_MAXWORD, the rest is not kept */
+
+    struct stegitCounters counters;
+};
+
+/**
+ * @brief header of the idx form
+ */
+struct stegitIdxHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t bits;                  /**< bits per code */
+    uint64_t checksum;              /**< codebookChecksum() of the codebook used for hiding */
+};
+
+/**
+ * @brief header of a seek index
+ */
+struct stegitIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t interval;              /**< words per entry */
+    uint64_t entries;               /**< number of entries */
+    uint64_t size;                  /**< size of the indexed hidden text */
+};
+
+/**
+ * @brief state of the seek index builder
+ */
+struct stegitIndexer {
+    uint32_t interval;
+    int inword;                     /**< the last byte was part of a word */
+    uint64_t offset;                /**< bytes scanned */
+    uint64_t words;                 /**< words started */
+};
+
+/**
+ * @brief Initializes a context
+ * @details clears the counters
+ * @param ctx the context
+ * @param book the codebook, NULL for the built in one
+ */
+void stegitInit(struct stegit *ctx, const struct codebook *book);
+
+/**
+ * @brief Draws dots and synonyms from a seeded stream of the context instead of rand()
+ * @param ctx the context
+ * @param seed the seed
+ */
+void stegitSeed(struct stegit *ctx, uint64_t seed);
+
+/**
+ * @brief Prepares a context for the next message
+ * @details keeps the codebook and the random stream
+ * @param ctx the context
+ */
+void stegitReset(struct stegit *ctx);
+
+/**
+ * @brief Size of the output buffer needed by stegitEncode()
+ * @param ctx the context
+ * @param length length of the plain text
+ * @return number of bytes
+ */
+size_t stegitEncodeBound(const struct stegit *ctx, size_t length);
+
+/**
+ * @brief Hides plain text
+ * @details stops after the end of the message, see ctx->end
+ * @param ctx the context
+ * @param in the plain text
+ * @param length length of the plain text
+ * @param out output buffer of stegitEncodeBound(ctx, length) bytes
+ * @return number of bytes written to out
+ */
+size_t stegitEncode(struct stegit *ctx, const char *in, size_t length, char *out);
+
+/**
+ * @brief Bits per code of the idx form
+ * @param ctx the context
+ * @return number of bits
+ */
+unsigned stegitIdxBits(const struct stegit *ctx);
+
+/**
+ * @brief Fills the header of the idx form
+ * @param ctx the context
+ * @param header the header
+ */
+void stegitIdxHeader(const struct stegit *ctx, struct stegitIdxHeader *header);
+
+/**
+ * @brief Checks whether an idx header belongs to the codebook of a context
+ * @param ctx the context
+ * @param header the header
+ * @return 0 if it does, -1 else
+ */
+int stegitIdxCheck(const struct stegit *ctx, const struct stegitIdxHeader *header);
+
+/**
+ * @brief Size of the packed codes of an idx block
+ * @param ctx the context
+ * @param count number of codes
+ * @return number of bytes after the code count
+ */
+size_t stegitIdxPackedSize(const struct stegit *ctx, uint32_t count);
+
+/**
+ * @brief Size of the output buffer needed by stegitEncodeIdx()
+ * @param ctx the context
+ * @param length length of the plain text
+ * @return number of bytes
+ */
+size_t stegitIdxBound(const struct stegit *ctx, size_t length);
+
+/**
+ * @brief Hides plain text in the idx form
+ * @details like stegitEncode(), but writes one idx block with the codes of the chosen words instead of the words
+ * @param ctx the context
+ * @param in the plain text
+ * @param length length of the plain text
+ * @param out output buffer of stegitIdxBound(ctx, length) bytes
+ * @return number of bytes written to out
+ */
+size_t stegitEncodeIdx(struct stegit *ctx, const char *in, size_t length, char *out);
+
+/**
+ * @brief Expands the codes of an idx block into the text form
+ * @details codes which are out of range are rendered as a single space, an empty word which decodes to nothing
+ * @param ctx the context
+ * @param packed the packed codes
+ * @param count number of codes
+ * @param out output buffer of stegitEncodeBound(ctx, count) bytes
+ * @return number of bytes written to out
+ */
+size_t stegitRenderIdx(const struct stegit *ctx, const char *packed, uint32_t count, char *out);
+
+/**
+ * @brief Finds hidden text in an idx block
+ * @details gives the same result as stegitDecode() on the rendered block: codes out of range decode to nothing,
+ * like the single space they are rendered as, but are counted as unknown
+ * @param ctx the context
+ * @param packed the packed codes
+ * @param count number of codes
+ * @param out output buffer of count bytes
+ * @return number of bytes written to out
+ */
+size_t stegitDecodeIdx(struct stegit *ctx, const char *packed, uint32_t count, char *out);
+
+/**
+ * @brief Advances the encoder over plain text without producing output
+ * @details The state after stegitScan() equals the state after stegitEncode() except for the dot and
+ * random state. It is used to start encoding in the middle of a message.
+ * @param ctx the context
+ * @param in the plain text
+ * @param length length of the plain text
+ * @return number of bytes stegitEncode() would consume
+ */
+size_t stegitScan(struct stegit *ctx, const char *in, size_t length);
+
+/**
+ * @brief Finds hidden text
+ * @details words are separated by space, dot and newline, unknown words are decoded as '\0'
+ * @param ctx the context
+ * @param in the hidden text
+ * @param length length of the hidden text
+ * @param out output buffer of length bytes
+ * @return number of bytes written to out
+ */
+size_t stegitDecode(struct stegit *ctx, const char *in, size_t length, char *out);
+
+/**
+ * @brief Decodes a word carried over at the end of the hidden text
+ * @param ctx the context
+ * @param out output buffer of one byte
+ * @return number of bytes written to out
+ */
+size_t stegitFinish(struct stegit *ctx, char *out);
+
+/**
+ * @brief Looks up a single word
+ * @param ctx the context
+ * @param word start of the word
+ * @param length length of the word
+ * @return plain character, '\0' if the word is no codeword
+ */
+char stegitDecodeWord(const struct stegit *ctx, const char *word, size_t length);
+
+/**
+ * @brief Initializes a seek index builder
+ * @param indexer the builder
+ * @param interval words per entry, at least 1
+ */
+void stegitIndexInit(struct stegitIndexer *indexer, uint32_t interval);
+
+/**
+ * @brief Collects the seek index entries of a piece of hidden text
+ * @details the pieces have to be passed in order, words may span pieces
+ * @param indexer the builder
+ * @param in the hidden text
+ * @param length length of the hidden text
+ * @param entries output buffer of length / interval + 1 entries
+ * @return number of entries written
+ */
+size_t stegitIndexScan(struct stegitIndexer *indexer, const char *in, size_t length, uint64_t *entries);
+
+/**
+ * @brief The built in codebook
+ * @return the compiled chiffre array, NULL if it could not be compiled
+ */
+const struct codebook *stegitDefaultCodebook(void);
+
+/**
+ * @brief encrypts a single character with the built in codebook
+ * @param plain the character which should be encrypted
+ * @return encrypted string, empty if the character can not be encrypted
+ */
+const char *encryptChar(char plain);
+
+/**
+ * @brief decrypts a string with the built in codebook
+ * @param chiffreChar the string which should be decrypted
+ * @return plain character, '\0' if the string is no codeword
+ */
+const char decryptChar(char *chiffreChar);
+
+#endif /* LIBSTEGIT_H */
@@ -0,0 +1,269 @@
+/**
+ * @file    stats.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the stats module
+ */
+
+#include "stats.h"
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define REPORTSIZE (1024)
+
+/**
+ * @brief output being formatted
+ * @details formatting only uses the stack, so it is safe inside the signal handler
+ */
+struct report {
+    char text[REPORTSIZE];
+    size_t length;
+};
+
+static uint64_t elapsed(const struct timespec *from, clockid_t clock);
+static void onProgress(int signal);
+static void writeReport(int progress);
+static void appendString(struct report *report, const char *string);
+static void appendNumber(struct report *report, uint64_t number);
+static void appendSeconds(struct report *report, uint64_t nanoseconds);
+static void appendField(struct report *report, const char *name, uint64_t number);
+static void appendTime(struct report *report, const char *name, uint64_t wall, uint64_t cpu, int first);
+
+static const char *stageNames[STATS_STAGES] = { "read", "codec", "write" };
+
+static const char *name = "stegit";
+static int asJson;
+static struct timespec started;
+static struct timespec startedCpu;
+
+static uint64_t bytesIn;
+static uint64_t bytesOut;
+static uint64_t symbols;
+static uint64_t dropped;
+static uint64_t unknown;
+static uint64_t stageWall[STATS_STAGES];
+static uint64_t stageCpu[STATS_STAGES];
+
+void statsInit(const char *command, int json)
+{
+    struct sigaction action;
+
+    name = command;
+    asJson = json;
+    (void) clock_gettime(CLOCK_MONOTONIC, &started);
+    (void) clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &startedCpu);
+
+    (void) memset(&action, 0, sizeof(action));
+    action.sa_handler = onProgress;
+    action.sa_flags = SA_RESTART;
+    (void) sigemptyset(&action.sa_mask);
+    (void) sigaction(SIGUSR1, &action, NULL);
+}
+
+void statsBegin(struct statsTimer *timer)
+{
+    (void) clock_gettime(CLOCK_MONOTONIC, &timer->wall);
+    (void) clock_gettime(CLOCK_THREAD_CPUTIME_ID, &timer->cpu);
+}
+
+void statsEnd(const struct statsTimer *timer, enum statsStage stage)
+{
+    (void) __atomic_add_fetch(&stageWall[stage], elapsed(&timer->wall, CLOCK_MONOTONIC), __ATOMIC_RELAXED);
+    (void) __atomic_add_fetch(&stageCpu[stage], elapsed(&timer->cpu, CLOCK_THREAD_CPUTIME_ID), __ATOMIC_RELAXED);
+}
+
+void statsBytesIn(uint64_t count)
+{
+    (void) __atomic_add_fetch(&bytesIn, count, __ATOMIC_RELAXED);
+}
+
+void statsBytesOut(uint64_t count)
+{
+    (void) __atomic_add_fetch(&bytesOut, count, __ATOMIC_RELAXED);
+}
+
+void statsCollect(struct stegitCounters *counters)
+{
+    (void) __atomic_add_fetch(&symbols, counters->symbols, __ATOMIC_RELAXED);
+    (void) __atomic_add_fetch(&dropped, counters->dropped, __ATOMIC_RELAXED);
+    (void) __atomic_add_fetch(&unknown, counters->unknown, __ATOMIC_RELAXED);
+    (void) memset(counters, 0, sizeof(*counters));
+}
+
+void statsReport(void)
+{
+    writeReport(0);
+}
+
+/**
+ * @brief Time since a point of a clock
+ * @param from the point
+ * @param clock the clock
+ * @return nanoseconds
+ */
+static uint64_t elapsed(const struct timespec *from, clockid_t clock)
+{
+    struct timespec now;
+
+    (void) clock_gettime(clock, &now);
+    return (uint64_t) (now.tv_sec - from->tv_sec) * 1000000000u + (uint64_t) now.tv_nsec - (uint64_t) from->tv_nsec;
+}
+
+/**
+ * @brief SIGUSR1 handler
+ * @param signal the signal
+ */
+static void onProgress(int signal)
+{
+    const int saved = errno;
+
+    (void) signal;
+    writeReport(1);
+    errno = saved;
+}
+
+/**
+ * @brief Formats the counters and writes them to stderr with a single write()
+ * @param progress 1 for a progress dump, 0 for the final report
+ * @details only uses async signal safe functions
+ */
+static void writeReport(int progress)
+{
+    struct report report;
+    uint64_t wall[STATS_STAGES];
+    uint64_t cpu[STATS_STAGES];
+
+    report.length = 0;
+
+    for(int i = 0; i < STATS_STAGES; i++){
+        wall[i] = __atomic_load_n(&stageWall[i], __ATOMIC_RELAXED);
+        cpu[i] = __atomic_load_n(&stageCpu[i], __ATOMIC_RELAXED);
+    }
+
+    if(asJson){
+        appendString(&report, "{\"progress\":");
+        appendString(&report, progress ? "true" : "false");
+    }else{
+        appendString(&report, name);
+        appendString(&report, progress ? ": progress:" : ": stats:");
+    }
+
+    appendField(&report, "bytes_in", __atomic_load_n(&bytesIn, __ATOMIC_RELAXED));
+    appendField(&report, "bytes_out", __atomic_load_n(&bytesOut, __ATOMIC_RELAXED));
+    appendField(&report, "symbols", __atomic_load_n(&symbols, __ATOMIC_RELAXED));
+    appendField(&report, "dropped", __atomic_load_n(&dropped, __ATOMIC_RELAXED));
+    appendField(&report, "unknown_words", __atomic_load_n(&unknown, __ATOMIC_RELAXED));
+
+    if(asJson){
+        appendString(&report, ",\"stages\":{");
+    }
+    for(int i = 0; i < STATS_STAGES; i++){
+        appendTime(&report, stageNames[i], wall[i], cpu[i], i == 0);
+    }
+    if(asJson){
+        appendString(&report, "}");
+    }
+
+    appendTime(&report, "total", elapsed(&started, CLOCK_MONOTONIC), elapsed(&startedCpu, CLOCK_PROCESS_CPUTIME_ID), 0);
+    appendString(&report, asJson ? "}\n" : "\n");
+
+    (void) write(STDERR_FILENO, report.text, report.length);
+}
+
+/**
+ * @brief Appends a string to a report
+ * @param report the report
+ * @param string the string, cut if the report is full
+ */
+static void appendString(struct report *report, const char *string)
+{
+    while(*string != '\0' && report->length < REPORTSIZE){
+        report->text[report->length++] = *string++;
+    }
+}
+
+/**
+ * @brief Appends a decimal number to a report
+ * @param report the report
+ * @param number the number
+ */
+static void appendNumber(struct report *report, uint64_t number)
+{
+    char digits[21];
+    size_t i = sizeof(digits) - 1;
+
+    digits[i] = '\0';
+    do{
+        digits[--i] = (char) ('0' + number % 10);
+        number /= 10;
+    }while(number != 0);
+
+    appendString(report, &digits[i]);
+}
+
+/**
+ * @brief Appends a time in seconds with millisecond precision to a report
+ * @param report the report
+ * @param nanoseconds the time
+ */
+static void appendSeconds(struct report *report, uint64_t nanoseconds)
+{
+    const uint64_t milliseconds = nanoseconds / 1000000u;
+
+    appendNumber(report, milliseconds / 1000);
+    appendString(report, ".");
+    appendString(report, milliseconds % 1000 < 100 ? (milliseconds % 1000 < 10 ? "00" : "0") : "");
+    appendNumber(report, milliseconds % 1000);
+}
+
+/**
+ * @brief Appends a counter to a report
+ * @param report the report
+ * @param field name of the counter
+ * @param number value of the counter
+ */
+static void appendField(struct report *report, const char *field, uint64_t number)
+{
+    if(asJson){
+        appendString(report, ",\"");
+        appendString(report, field);
+        appendString(report, "\":");
+    }else{
+        appendString(report, " ");
+        appendString(report, field);
+        appendString(report, "=");
+    }
+
+    appendNumber(report, number);
+}
+
+/**
+ * @brief Appends the wall and cpu time of a stage to a report
+ * @param report the report
+ * @param stage name of the stage
+ * @param wall wall time in nanoseconds
+ * @param cpu cpu time in nanoseconds
+ * @param first no separator is needed in JSON
+ */
+static void appendTime(struct report *report, const char *stage, uint64_t wall, uint64_t cpu, int first)
+{
+    if(asJson){
+        appendString(report, first ? "\"" : ",\"");
+        appendString(report, stage);
+        appendString(report, "\":{\"wall\":");
+        appendSeconds(report, wall);
+        appendString(report, ",\"cpu\":");
+        appendSeconds(report, cpu);
+        appendString(report, "}");
+    }else{
+        appendString(report, " ");
+        appendString(report, stage);
+        appendString(report, "=");
+        appendSeconds(report, wall);
+        appendString(report, "s/");
+        appendSeconds(report, cpu);
+        appendString(report, "s");
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file    stats.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Throughput and time counters of stegit
+ * @details The counters are updated once per block with relaxed atomic additions, so they are always on and
+ * may be updated from any thread. SIGUSR1 writes the current counters to stderr, statsReport() writes the final
+ * ones. Both use plain text or a single line of JSON.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "libstegit.h"
+
+/**
+ * @brief stages whose time is measured
+ */
+enum statsStage {
+    STATS_READ,
+    STATS_CODEC,
+    STATS_WRITE,
+    STATS_STAGES
+};
+
+/**
+ * @brief start of a measured interval, see statsBegin()
+ */
+struct statsTimer {
+    struct timespec wall;
+    struct timespec cpu;            /**< cpu time of the calling thread */
+};
+
+/**
+ * @brief Starts the clock and installs the SIGUSR1 handler
+ * @param command name of the program, used as prefix of the text output
+ * @param json 1 to report in JSON
+ */
+void statsInit(const char *command, int json);
+
+/**
+ * @brief Starts measuring an interval
+ * @param timer the interval
+ */
+void statsBegin(struct statsTimer *timer);
+
+/**
+ * @brief Adds the wall and cpu time since statsBegin() to a stage
+ * @param timer the interval
+ * @param stage the stage
+ */
+void statsEnd(const struct statsTimer *timer, enum statsStage stage);
+
+/**
+ * @brief Counts input bytes
+ * @param count number of bytes
+ */
+void statsBytesIn(uint64_t count);
+
+/**
+ * @brief Counts output bytes
+ * @param count number of bytes
+ */
+void statsBytesOut(uint64_t count);
+
+/**
+ * @brief Moves the counters of a context into the totals
+ * @param counters the counters, cleared
+ */
+void statsCollect(struct stegitCounters *counters);
+
+/**
+ * @brief Writes the totals to stderr
+ */
+void statsReport(void);
+
+#endif /* STATS_H */
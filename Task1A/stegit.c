@@ -12,24 +12,145 @@
 #include <getopt.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "codebook.h"
+#include "libstegit.h"
+#include "stats.h"
 
-#define MAXLENGTH (300)
+#define INBUFFERSIZE (64 * 1024)
+#define JOBSIZE (256 * 1024)            /* input bytes per job of runParallel() */
+#define READBLOCKSIZE (1024 * 1024)
+#define MAXWORDLENGTH (CODEBOOK_MAXWORD)    /* longer words can not be codewords */
+#define PIPEBUFFERS (8)                 /* buffers per stage of runPipeline(), a power of two */
+#define INDEXINTERVAL (4096)            /* words per entry of a seek index */
+#define RANGEBLOCKSIZE (64 * 1024)      /* hidden text decoded at once by findRange() */
+
+/**
+ * @brief life cycle of a job of runParallel()
+ */
+enum jobstate {
+    JOB_FREE,
+    JOB_READY,
+    JOB_BUSY,
+    JOB_DONE
+};
+
+/**
+ * @brief block of input encoded or decoded by one worker
+ */
+struct job {
+    char *in;
+    size_t inlength;
+    char *out;
+    size_t outlength;
+    struct stegit ctx;          /* start state in hide mode */
+    int last;                   /* no more input follows */
+    enum jobstate state;
+};
+
+/**
+ * @brief worker pool of runParallel()
+ * @details jobs is used as a ring, job i lives in slot i % njobs
+ */
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       /* a job was submitted or quit was set */
+    pthread_cond_t done;        /* a job is done */
+    struct job *jobs;
+    size_t njobs;
+    uint64_t submitted;         /* number of jobs handed to the workers */
+    uint64_t taken;             /* number of jobs taken by the workers */
+    int hide;
+    int quit;
+};
+
+/**
+ * @brief seek index file being written
+ */
+struct indexWriter {
+    FILE *file;
+    struct stegitIndexer indexer;
+    struct stegitIndexHeader header;
+};
+
+/**
+ * @brief buffer passed between the stages of runPipeline()
+ */
+struct buffer {
+    char *data;
+    size_t length;
+    int last;                   /* no more buffers follow */
+};
+
+/**
+ * @brief single producer single consumer ring of buffers
+ * @details head and tail are only written by the producer respectively the consumer, items counts the
+ *          buffers in the ring and is only used to sleep while the ring is empty
+ */
+struct ring {
+    struct buffer *slots[PIPEBUFFERS];
+    uint64_t head;
+    uint64_t tail;
+    sem_t items;
+};
+
+/**
+ * @brief stages of runPipeline()
+ * @details the buffers circulate reader -> codec -> writer, the empty ones go back through inFree and outFree
+ */
+struct pipeline {
+    struct ring inFull;         /* reader -> codec */
+    struct ring inFree;         /* codec -> reader */
+    struct ring outFull;        /* codec -> writer */
+    struct ring outFree;        /* writer -> codec */
+    struct stegit ctx;
+    int hide;
+    int stop;                   /* the message ended, the reader may stop */
+};
 
 static void usage(void);
-void encryptText(void);
+static uint64_t jobSeed(uint64_t seed, uint64_t index);
+static void writeBlock(int fd, const char *buff, size_t length);
+static void *worker(void *arg);
+static void writeJob(struct pool *pool, uint64_t index, int fd);
+static size_t fillFindJob(char *in, char *leftover, size_t *leftoverlength, int *eof);
+static size_t readFull(char *buff, size_t length);
+static size_t readSome(char *buff, size_t length);
+static int peekIdx(void);
+static void readIdx(int render);
+static void openIndex(struct indexWriter *writer, const char *path);
+static void appendIndex(struct indexWriter *writer, const char *data, size_t length);
+static void closeIndex(struct indexWriter *writer);
+static void parseRange(const char *arg, uint64_t *start, uint64_t *length);
+void encryptText(int idx, const char *indexpath);
+void indexText(const char *indexpath);
+void findRange(uint64_t start, uint64_t length, const char *indexpath);
 void decryptText(void);
-const char * encryptChar(char plain);
-const char decryptChar(char* chiffreChar);
+void renderText(void);
+static void ringInit(struct ring *ring);
+static void ringPush(struct ring *ring, struct buffer *buff);
+static struct buffer *ringPop(struct ring *ring);
+static void *pipeReader(void *arg);
+static void *pipeCodec(void *arg);
+static void *pipeWriter(void *arg);
+void runParallel(int hide, int threads, uint64_t seed);
+void runPipeline(int hide);
 char *command = "<not set>";
 
-char* chiffre[28] = {
-        "die", "sonne", "der", "das", "um",
-        "neun", "Uhr", "aufgeht", "blumme", "baum",
-        "Alice", "Bob", "schauen", "schlafen", "und",
-        "darum", "deshalb", "Stein", "Baum", "blau", "gelb",
-        "groß", "klein", "Fahne", "stehen",
-        "zehn", "Mond", "Ende"
-};
+/* Codebook in use, the chiffre array unless -c is given */
+static const struct codebook *book;
+
+/* Bytes read ahead by peekIdx(), handed out again by readSome() */
+static char peeked[sizeof(STEGIT_IDXMAGIC)];
+static size_t peekedlength;
+static size_t peekedoffset;
 
 /**
  * @brief       Main entry point
@@ -45,12 +166,45 @@ int main(int argc, char **argv) {
     int opt_f = 0;
     int opt_h = 0;
     int opt_o = 0;
+    int opt_j = 0;
+    int opt_seed = 0;
+    int opt_p = 0;
+    int opt_idx = 0;
+    int opt_render = 0;
+    int opt_index = 0;
+    int opt_range = 0;
+    int opt_stats = 0;
     char* val_o = NULL;
+    char* val_c = NULL;
+    char* val_index = NULL;
+    uint64_t val_start = 0;
+    uint64_t val_length = 0;
+    long val_j = 1;
+    uint64_t val_seed = (uint64_t) time(NULL);
+    char* endptr;
     FILE* file = NULL;
+    struct codebook *loaded = NULL;
+    const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'S' },
+        { "format", required_argument, NULL, 'F' },
+        { "index", required_argument, NULL, 'I' },
+        { "range", required_argument, NULL, 'R' },
+        { "stats", optional_argument, NULL, 'T' },
+        { NULL, 0, NULL, 0 }
+    };
 
     srand(time(NULL));
 
-    while ((c = getopt(argc,argv,"fho:")) != -1){
+    //Subcommands
+    if(argc > 1 && (strcmp(argv[1], "render") == 0 || strcmp(argv[1], "index") == 0)){
+        opt_render = argv[1][0] == 'r';
+        opt_index = argv[1][0] == 'i';
+        argv[1] = argv[0];
+        argc--;
+        argv++;
+    }
+
+    while ((c = getopt_long(argc,argv,"fhpo:j:c:",longopts,NULL)) != -1){
 
         switch(c){
             case 'f':
@@ -59,10 +213,55 @@ int main(int argc, char **argv) {
             case 'h':
                 opt_h = 1;
                 break;
+            case 'p':
+                opt_p = 1;
+                break;
             case 'o':
                 opt_o = 1;
                 val_o = optarg;
                 break;
+            case 'c':
+                val_c = optarg;
+                break;
+            case 'j':
+                opt_j = 1;
+                val_j = strtol(optarg, &endptr, 10);
+                if(*endptr != '\0' || val_j < 1 || val_j > 1024){
+                    usage();
+                }
+                break;
+            case 'S':
+                opt_seed = 1;
+                val_seed = strtoull(optarg, &endptr, 10);
+                if(*endptr != '\0' || *optarg == '\0'){
+                    usage();
+                }
+                break;
+            case 'F':
+                if(strcmp(optarg, "idx") == 0){
+                    opt_idx = 1;
+                }else if(strcmp(optarg, "text") == 0){
+                    opt_idx = 0;
+                }else{
+                    usage();
+                }
+                break;
+            case 'I':
+                val_index = optarg;
+                break;
+            case 'R':
+                opt_range = 1;
+                parseRange(optarg, &val_start, &val_length);
+                break;
+            case 'T':
+                if(optarg == NULL || strcmp(optarg, "text") == 0){
+                    opt_stats = 1;
+                }else if(strcmp(optarg, "json") == 0){
+                    opt_stats = 2;
+                }else{
+                    usage();
+                }
+                break;
             default:
                 usage();
                 break;
@@ -90,9 +289,58 @@ int main(int argc, char **argv) {
         usage();
     }
 
-    //Hide mode
-    if(opt_h){
-        encryptText();
+    //Pipelined mode keeps the serial output, chunked mode has its own
+    if(opt_p && (opt_j || opt_seed)){
+        usage();
+    }
+
+    //The idx form is written by the serial hide mode only, render takes no mode
+    if((opt_idx && (!opt_h || opt_p || opt_j || opt_seed)) ||
+       (opt_render && (opt_f || opt_h || opt_p || opt_j || opt_seed))){
+        usage();
+    }
+
+    //Seek index: written by the serial text hide mode or the index subcommand, read by --range
+    if((opt_index && (val_index == NULL || opt_f || opt_h || opt_p || opt_j || opt_seed || opt_range)) ||
+       (opt_range && (!opt_f || opt_p || opt_j || opt_seed)) ||
+       (val_index != NULL && !opt_index && !opt_range && (!opt_h || opt_idx || opt_p || opt_j || opt_seed))){
+        usage();
+    }
+
+    //Counters are always kept, SIGUSR1 shows them
+    statsInit(command, opt_stats == 2);
+
+    //Codebook
+    if(val_c != NULL){
+        loaded = loadCodebook(val_c);
+        if(loaded == NULL){
+            (void) fprintf(stderr, "%s: could not load codebook %s\n", command, val_c);
+            exit(EXIT_FAILURE);
+        }
+        book = loaded;
+    }else{
+        book = stegitDefaultCodebook();
+        if(book == NULL){
+            (void) fprintf(stderr, "%s: could not compile the codebook\n", command);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Chunked modes
+    if(opt_render){ //Render idx form
+        renderText();
+    }else if(opt_index){ //Build seek index
+        indexText(val_index);
+    }else if(opt_range){ //Decode a slice
+        findRange(val_start, val_length, val_index);
+    }else if(opt_f && (opt_j || opt_seed || opt_p) && peekIdx()){ //Idx form, decoded by table lookups
+        readIdx(0);
+    }else if((opt_j || opt_seed) && (opt_h || opt_f)){
+        runParallel(opt_h, (int) val_j, val_seed);
+    }else if(opt_p && (opt_h || opt_f)){ //Pipelined mode
+        runPipeline(opt_h);
+    }else if(opt_h){ //Hide mode
+        encryptText(opt_idx, val_index);
     }else if(opt_f){ //Find mode
         decryptText();
     }else{
@@ -104,166 +352,997 @@ int main(int argc, char **argv) {
         (void) fclose(file);
     }
 
+    if(opt_stats){
+        statsReport();
+    }
+
+    freeCodebook(loaded);
+
     return 0;
 }
 
 /**
  * @name        encryptText
  * @brief       encrypts text from the standart input
- * @detail      encrypts text from the standart input and writes the outcome to stdout
+ * @param       idx 1 to write the idx form instead of the text form
+ * @param       indexpath seek index to write alongside the text form, NULL for none
+ * @detail      encrypts text from the standart input and writes the outcome to stdout.
+ *              The input is read in blocks which are encoded with stegitEncode() and written with one write()
+ *              per block. The output is byte-identical to the former fgets() based loop: encoding stops at the
+ *              first newline (or 0xff, which the old loop mistook for EOF) and a '\0' skips the rest of its 299
+ *              byte fgets() chunk. In the idx form every block of input becomes one idx block.
  */
-void encryptText(void){
+void encryptText(int idx, const char *indexpath){
 
-    char buff[MAXLENGTH];
-    int dotcount = 0;
-    int i = 0;
+    static char in[INBUFFERSIZE];
+    struct indexWriter writer;
+    struct stegit ctx;
+    struct statsTimer timer;
+    char *out;
+    const int outfd = fileno(stdout);
+    size_t n;
 
-    while(fgets(buff, MAXLENGTH, stdin) != NULL && i > -1){
+    stegitInit(&ctx, book);
+    out = malloc(idx ? stegitIdxBound(&ctx, INBUFFERSIZE) : stegitEncodeBound(&ctx, INBUFFERSIZE));
 
-        i = 0;
-        while(i < MAXLENGTH && buff[i] != EOF && buff[i] != '\n' && buff[i] != '\0'){
+    if(out == NULL){
+        (void) fprintf(stderr, "%s: malloc: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-            //Encrypted character
-            (void) fputs(encryptChar(buff[i]),stdout);
+    if(indexpath != NULL){
+        openIndex(&writer, indexpath);
+    }
 
-            //Dot
-            if(dotcount >= 5 && dotcount <= 15){
-                if(rand() % 3 == 0 || dotcount == 15){
-                    (void) fputs(".",stdout);
-                    dotcount = 0;
-                }
-            }
+    if(idx){
+        struct stegitIdxHeader header;
+
+        stegitIdxHeader(&ctx, &header);
+        writeBlock(outfd, (const char *) &header, sizeof(header));
+    }
 
-            //Space after word
-            (void) fputs(" ",stdout);
+    while(!ctx.end && (n = readSome(in, sizeof(in))) != 0){
+        size_t length;
 
-            i++;
-            dotcount++;
+        statsBegin(&timer);
+        length = idx ? stegitEncodeIdx(&ctx, in, n, out) : stegitEncode(&ctx, in, n, out);
+        statsCollect(&ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
+
+        if(indexpath != NULL){
+            appendIndex(&writer, out, length);
         }
+        writeBlock(outfd, out, length);
+    }
 
-        if(buff[i] == EOF || buff[i] == '\n'){
-            (void) fputs("\n",stdout);
-            i = -1;
+    if(indexpath != NULL){
+        closeIndex(&writer);
+    }
+
+    free(out);
+}
+
+/**
+ * @name        writeBlock
+ * @brief       writes a whole buffer to a file descriptor
+ * @param       fd the file descriptor
+ * @param       buff the data
+ * @param       length number of bytes to write
+ * @detail      retries on partial writes, exits with EXIT_FAILURE if writing fails, counts the time and the bytes
+ *              for --stats
+ */
+static void writeBlock(int fd, const char *buff, size_t length){
+
+    struct statsTimer timer;
+
+    statsBegin(&timer);
+    statsBytesOut(length);
+
+    while(length > 0){
+        ssize_t s = write(fd, buff, length);
+
+        if(s < 0){
+            if(errno == EINTR) continue;
+            (void) fprintf(stderr, "%s: write: %s\n", command, strerror(errno));
+            exit(EXIT_FAILURE);
         }
+
+        buff += s;
+        length -= (size_t) s;
     }
+
+    statsEnd(&timer, STATS_WRITE);
 }
 
 /**
  * @name        decryptText
  * @brief       decrypts text from the standart input
- * @detail      decrypts text from the standart input and writes the outcome to stdout
+ * @detail      decrypts text from the standart input and writes the outcome to stdout.
+ *              Regular files are memory mapped, other input is read in blocks of READBLOCKSIZE bytes. The
+ *              blocks are decoded with stegitDecode(), which carries words across block boundaries.
+ *              Input starting with STEGIT_IDXMAGIC is read as idx form.
  */
 void decryptText(void) {
-    char buff[MAXLENGTH];
-
-    int end = 0;
 
-    char* wordstart = &buff[0];
+    static struct stegit ctx;
+    static char buff[READBLOCKSIZE];
+    static char out[READBLOCKSIZE + 1];
+    const int outfd = fileno(stdout);
+    struct stat st;
+    struct statsTimer timer;
+    size_t inlength;
+    size_t n;
+    int mapped = 0;
 
-    while( fgets(buff,MAXLENGTH,stdin) != NULL){
+    //Idx form
+    inlength = readFull(buff, sizeof(STEGIT_IDXMAGIC));
+    if(inlength == sizeof(STEGIT_IDXMAGIC) && memcmp(buff, STEGIT_IDXMAGIC, inlength) == 0){
+        readIdx(0);
+        return;
+    }
 
+    stegitInit(&ctx, book);
 
-        int i = 0;
+    //The mapping starts at the beginning of the file and includes the prefix
+    if(fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+        const size_t length = (size_t) st.st_size;
+        char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
 
-        while(i < MAXLENGTH && !end){
+        if(data != MAP_FAILED){
+            (void) madvise(data, length, MADV_SEQUENTIAL);
+            statsBytesIn(length - inlength);
+            for(size_t offset = 0; offset < length; offset += READBLOCKSIZE){
+                const size_t slice = length - offset < READBLOCKSIZE ? length - offset : READBLOCKSIZE;
 
-            //End of word with space or dot
-            if(buff[i] == ' ' || buff[i] == '.'){
-                buff[i] = '\0';
+                statsBegin(&timer);
+                n = stegitDecode(&ctx, &data[offset], slice, out);
+                statsCollect(&ctx.counters);
+                statsEnd(&timer, STATS_CODEC);
+                writeBlock(outfd, out, n);
             }
+            (void) munmap(data, length);
+            mapped = 1;
+        }
+    }
 
-            if(buff[i] == '\0'){
-                if(wordstart != &buff[i]){
-                    (void) fputc(decryptChar(wordstart),stdout);
-                }
+    //Not mapped, read in blocks starting with the prefix
+    while(!mapped && inlength != 0){
+        statsBegin(&timer);
+        n = stegitDecode(&ctx, buff, inlength, out);
+        statsCollect(&ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
+        writeBlock(outfd, out, n);
 
-                if(i + 1 < MAXLENGTH ){
-                    wordstart = &buff[i+1];
-                }
-            }
+        inlength = readSome(buff, sizeof(buff));
+    }
 
-            if(buff[i] == EOF){
-                buff[i] = '\0';
-                end = 1;
+    //Last word without delimiter
+    n = stegitFinish(&ctx, out);
+    statsCollect(&ctx.counters);
+    writeBlock(outfd, out, n);
+}
 
-                if(wordstart != &buff[i]){
-                    (void) fputc(decryptChar(wordstart),stdout);
-                }
+/**
+ * @name        indexText
+ * @brief       builds the seek index of hidden text from the standart input
+ * @param       indexpath the index file
+ */
+void indexText(const char *indexpath){
+
+    static char buff[READBLOCKSIZE];
+    struct indexWriter writer;
+    size_t n;
+
+    openIndex(&writer, indexpath);
+
+    while((n = readFull(buff, sizeof(buff))) != 0){
+        appendIndex(&writer, buff, n);
+    }
+
+    closeIndex(&writer);
+}
+
+/**
+ * @name        findRange
+ * @brief       decrypts a slice of the hidden text from the standart input
+ * @param       start offset of the slice in the plain text
+ * @param       length length of the slice
+ * @param       indexpath seek index of the input, NULL to decode from the beginning
+ * @detail      The input has to be a regular file, it is memory mapped. The index gives the position of the
+ *              word which decodes to plain text byte start rounded down to a multiple of the interval, decoding
+ *              starts there and stops as soon as the slice is complete.
+ */
+void findRange(uint64_t start, uint64_t length, const char *indexpath){
+
+    static char out[RANGEBLOCKSIZE + 1];
+    struct stegit ctx;
+    struct statsTimer timer;
+    struct stat st;
+    uint64_t offset = 0;
+    uint64_t skip = start;
+    size_t size;
+    char *data;
+
+    if(fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode)){
+        (void) fprintf(stderr, "%s: --range needs a regular file as input\n", command);
+        exit(EXIT_FAILURE);
+    }
+
+    size = (size_t) st.st_size;
+    if(size == 0 || length == 0){
+        return;
+    }
+
+    if(indexpath != NULL){
+        struct stegitIndexHeader header;
+        FILE *file = fopen(indexpath, "r");
+
+        if(file == NULL || fread(&header, sizeof(header), 1, file) != 1 ||
+           memcmp(header.magic, STEGIT_INDEXMAGIC, sizeof(STEGIT_INDEXMAGIC)) != 0 ||
+           header.version != STEGIT_INDEXVERSION || header.interval == 0){
+            (void) fprintf(stderr, "%s: %s is no seek index\n", command, indexpath);
+            exit(EXIT_FAILURE);
+        }
+        if(header.size != (uint64_t) size){
+            (void) fprintf(stderr, "%s: %s does not belong to the input\n", command, indexpath);
+            exit(EXIT_FAILURE);
+        }
+
+        if(header.entries > 0){
+            uint64_t entry = start / header.interval;
+
+            if(entry >= header.entries){
+                entry = header.entries - 1;
             }
 
-            i++;
+            if(fseek(file, (long) (sizeof(header) + entry * sizeof(offset)), SEEK_SET) != 0 ||
+               fread(&offset, sizeof(offset), 1, file) != 1 || offset >= size){
+                (void) fprintf(stderr, "%s: %s is corrupt\n", command, indexpath);
+                exit(EXIT_FAILURE);
+            }
+            skip = start - entry * header.interval;
+        }
+
+        (void) fclose(file);
+    }
+
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if(data == MAP_FAILED){
+        (void) fprintf(stderr, "%s: mmap: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    stegitInit(&ctx, book);
+
+    while(length > 0 && offset < size){
+        const size_t slice = size - offset < RANGEBLOCKSIZE ? size - offset : RANGEBLOCKSIZE;
+        size_t n;
+
+        statsBegin(&timer);
+        n = stegitDecode(&ctx, &data[offset], slice, out);
+        offset += slice;
+        if(offset == size){
+            n += stegitFinish(&ctx, &out[n]);
+        }
+        statsCollect(&ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
+        statsBytesIn(slice);
+
+        if(skip >= n){
+            skip -= n;
+            continue;
+        }
+
+        n -= (size_t) skip;
+        if(n > length){
+            n = (size_t) length;
+        }
+        writeBlock(fileno(stdout), &out[skip], n);
+        length -= n;
+        skip = 0;
+    }
+
+    (void) munmap(data, size);
+}
+
+/**
+ * @name        openIndex
+ * @brief       creates a seek index file
+ * @param       writer the index being written
+ * @param       path the file
+ * @detail      the header is written by closeIndex(), exits with EXIT_FAILURE on error
+ */
+static void openIndex(struct indexWriter *writer, const char *path){
+
+    writer->file = fopen(path, "w");
+    if(writer->file == NULL){
+        (void) fprintf(stderr, "%s: could not open %s: %s\n", command, path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    stegitIndexInit(&writer->indexer, INDEXINTERVAL);
+
+    (void) memset(&writer->header, 0, sizeof(writer->header));
+    (void) memcpy(writer->header.magic, STEGIT_INDEXMAGIC, sizeof(STEGIT_INDEXMAGIC));
+    writer->header.version = STEGIT_INDEXVERSION;
+    writer->header.interval = INDEXINTERVAL;
+
+    if(fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1){
+        (void) fprintf(stderr, "%s: could not write %s\n", command, path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @name        appendIndex
+ * @brief       adds the entries of a piece of hidden text to a seek index
+ * @param       writer the index being written
+ * @param       data the hidden text
+ * @param       length length of the hidden text
+ */
+static void appendIndex(struct indexWriter *writer, const char *data, size_t length){
+
+    static uint64_t entries[READBLOCKSIZE / INDEXINTERVAL + 1];
+    struct statsTimer timer;
+
+    while(length > 0){
+        const size_t slice = length < READBLOCKSIZE ? length : READBLOCKSIZE;
+        size_t count;
+
+        statsBegin(&timer);
+        count = stegitIndexScan(&writer->indexer, data, slice, entries);
+        statsEnd(&timer, STATS_CODEC);
+
+        if(fwrite(entries, sizeof(entries[0]), count, writer->file) != count){
+            (void) fprintf(stderr, "%s: could not write the seek index\n", command);
+            exit(EXIT_FAILURE);
+        }
+
+        writer->header.entries += count;
+        data += slice;
+        length -= slice;
+    }
+}
+
+/**
+ * @name        closeIndex
+ * @brief       completes the header of a seek index and closes it
+ * @param       writer the index being written
+ */
+static void closeIndex(struct indexWriter *writer){
+
+    writer->header.size = writer->indexer.offset;
+
+    if(fseek(writer->file, 0, SEEK_SET) != 0 ||
+       fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1 ||
+       fclose(writer->file) != 0){
+        (void) fprintf(stderr, "%s: could not write the seek index\n", command);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @name        parseRange
+ * @brief       parses the argument of --range
+ * @param       arg the argument, "<start>:<length>"
+ * @param       start offset of the slice
+ * @param       length length of the slice
+ * @detail      calls usage() if the argument is malformed
+ */
+static void parseRange(const char *arg, uint64_t *start, uint64_t *length){
+
+    char *endptr;
+
+    *start = strtoull(arg, &endptr, 10);
+    if(endptr == arg || *endptr != ':'){
+        usage();
+    }
+
+    arg = endptr + 1;
+    *length = strtoull(arg, &endptr, 10);
+    if(endptr == arg || *endptr != '\0'){
+        usage();
+    }
+}
+
+/**
+ * @name        renderText
+ * @brief       expands the idx form from the standart input into the text form
+ * @detail      the blocks are rendered one by one as they are read
+ */
+void renderText(void){
+
+    char magic[sizeof(STEGIT_IDXMAGIC)];
+
+    if(readFull(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, STEGIT_IDXMAGIC, sizeof(magic)) != 0){
+        (void) fprintf(stderr, "%s: input is not in the idx form\n", command);
+        exit(EXIT_FAILURE);
+    }
+
+    readIdx(1);
+}
+
+/**
+ * @name        readIdx
+ * @brief       renders or decodes the idx form from the standart input
+ * @param       render 1 to write the text form, 0 to write the plain text
+ * @detail      the magic has been read already, exits with EXIT_FAILURE if the header does not match the codebook
+ *              or the input is truncated
+ */
+static void readIdx(int render){
+
+    struct stegitIdxHeader header;
+    struct stegit ctx;
+    struct statsTimer timer;
+    char *packed;
+    char *out;
+    uint32_t count;
+    size_t n;
+
+    stegitInit(&ctx, book);
+
+    (void) memcpy(header.magic, STEGIT_IDXMAGIC, sizeof(STEGIT_IDXMAGIC));
+    n = sizeof(header) - sizeof(header.magic);
+    if(readFull((char *) &header + sizeof(header.magic), n) != n){
+        (void) fprintf(stderr, "%s: truncated idx header\n", command);
+        exit(EXIT_FAILURE);
+    }
+    if(stegitIdxCheck(&ctx, &header) != 0){
+        (void) fprintf(stderr, "%s: idx input was written with another codebook or version\n", command);
+        exit(EXIT_FAILURE);
+    }
+
+    packed = malloc(stegitIdxPackedSize(&ctx, INBUFFERSIZE));
+    out = malloc(render ? stegitEncodeBound(&ctx, INBUFFERSIZE) : INBUFFERSIZE);
+    if(packed == NULL || out == NULL){
+        (void) fprintf(stderr, "%s: malloc: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    while((n = readFull((char *) &count, sizeof(count))) != 0){
+
+        //encryptText() writes at most one code per input byte
+        if(n != sizeof(count) || count > INBUFFERSIZE){
+            (void) fprintf(stderr, "%s: corrupt idx block\n", command);
+            exit(EXIT_FAILURE);
+        }
+
+        n = stegitIdxPackedSize(&ctx, count);
+        if(readFull(packed, n) != n){
+            (void) fprintf(stderr, "%s: truncated idx block\n", command);
+            exit(EXIT_FAILURE);
+        }
+
+        statsBegin(&timer);
+        n = render ? stegitRenderIdx(&ctx, packed, count, out) : stegitDecodeIdx(&ctx, packed, count, out);
+        statsCollect(&ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
+        writeBlock(fileno(stdout), out, n);
+    }
+
+    free(packed);
+    free(out);
+}
+
+/**
+ * @name        runParallel
+ * @brief       hides or finds text from the standart input on a pool of worker threads
+ * @param       hide 1 for hide mode, 0 for find mode
+ * @param       threads number of worker threads
+ * @param       seed seed of the dot positions in hide mode
+ * @detail      The input is split into jobs of at most JOBSIZE bytes. Hide jobs are cut at fixed offsets, their
+ *              chunk state is computed with stegitScan() and every job gets its own dot stream derived from seed
+ *              and the job index, so the output only depends on the seed and not on the number of threads.
+ *              Find jobs are cut after the last delimiter. The main thread reads the input and writes the
+ *              finished jobs in order.
+ */
+void runParallel(int hide, int threads, uint64_t seed){
+
+    static struct pool pool;
+    static char leftover[JOBSIZE];
+    size_t leftoverlength = 0;
+    const int outfd = fileno(stdout);
+    struct stegit state;
+    size_t outsize;
+    pthread_t *workers;
+    uint64_t written = 0;
+    uint64_t index;
+    int eof = 0;
+
+    stegitInit(&state, book);
+    outsize = hide ? stegitEncodeBound(&state, JOBSIZE) : JOBSIZE + 1;
+
+    pool.njobs = 2 * (size_t) threads;
+    pool.jobs = calloc(pool.njobs, sizeof(struct job));
+    workers = calloc((size_t) threads, sizeof(pthread_t));
+    if(pool.jobs == NULL || workers == NULL){
+        (void) fprintf(stderr, "%s: calloc: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t i = 0; i < pool.njobs; i++){
+        pool.jobs[i].in = malloc(JOBSIZE);
+        pool.jobs[i].out = malloc(outsize);
+        if(pool.jobs[i].in == NULL || pool.jobs[i].out == NULL){
+            (void) fprintf(stderr, "%s: malloc: %s\n", command, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pool.hide = hide;
+    (void) pthread_mutex_init(&pool.lock, NULL);
+    (void) pthread_cond_init(&pool.ready, NULL);
+    (void) pthread_cond_init(&pool.done, NULL);
+
+    for(int i = 0; i < threads; i++){
+        if(pthread_create(&workers[i], NULL, worker, &pool) != 0){
+            (void) fprintf(stderr, "%s: pthread_create failed\n", command);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(index = 0; !eof; index++){
+        struct job *job = &pool.jobs[index % pool.njobs];
+
+        //Slot still holds an older job
+        if(index >= pool.njobs){
+            writeJob(&pool, written++, outfd);
         }
+
+        if(hide){
+            job->inlength = readFull(job->in, JOBSIZE);
+            job->ctx = state;
+            stegitSeed(&job->ctx, jobSeed(seed, index));
+            job->inlength = stegitScan(&state, job->in, job->inlength);
+            eof = job->inlength < JOBSIZE || state.end;
+        }else{
+            job->inlength = fillFindJob(job->in, leftover, &leftoverlength, &eof);
+        }
+
+        if(job->inlength == 0){
+            break;
+        }
+
+        job->last = eof;
+
+        (void) pthread_mutex_lock(&pool.lock);
+        job->state = JOB_READY;
+        pool.submitted++;
+        (void) pthread_cond_signal(&pool.ready);
+        (void) pthread_mutex_unlock(&pool.lock);
+    }
+
+    while(written < pool.submitted){
+        writeJob(&pool, written++, outfd);
+    }
+
+    (void) pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    (void) pthread_cond_broadcast(&pool.ready);
+    (void) pthread_mutex_unlock(&pool.lock);
+
+    for(int i = 0; i < threads; i++){
+        (void) pthread_join(workers[i], NULL);
+    }
+
+    for(size_t i = 0; i < pool.njobs; i++){
+        free(pool.jobs[i].in);
+        free(pool.jobs[i].out);
     }
+    free(pool.jobs);
+    free(workers);
 }
 
 /**
- * @name    decryptChar
- * @brief   decrypts a string
- * @param   chiffreChar the string which should be decrypted
- * @return  plain character
- * @detail  decrypts a string according to the chiffre array
+ * @name        worker
+ * @brief       worker thread of runParallel()
+ * @param       arg the pool
+ * @return      NULL
+ * @detail      takes the jobs in submission order and encodes or decodes them into their output buffer
  */
-const char decryptChar(char* chiffreChar){
+static void *worker(void *arg){
 
-    int i = 0;
+    struct pool *pool = arg;
+    struct statsTimer timer;
 
-    while(i < 28){
+    for(;;){
+        struct job *job;
 
-        if(strcmp(chiffreChar,chiffre[i]) == 0){
+        (void) pthread_mutex_lock(&pool->lock);
+        while(!pool->quit && pool->taken == pool->submitted){
+            (void) pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+        if(pool->taken == pool->submitted){
+            (void) pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = &pool->jobs[pool->taken++ % pool->njobs];
+        job->state = JOB_BUSY;
+        (void) pthread_mutex_unlock(&pool->lock);
 
-            //Dot
-            if(i == 27){
-                return (char) 46;
+        statsBegin(&timer);
+        if(pool->hide){
+            job->outlength = stegitEncode(&job->ctx, job->in, job->inlength, job->out);
+        }else{
+            stegitInit(&job->ctx, book);
+            job->outlength = stegitDecode(&job->ctx, job->in, job->inlength, job->out);
+            if(job->last){
+                job->outlength += stegitFinish(&job->ctx, &job->out[job->outlength]);
             }
+        }
+        statsCollect(&job->ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
 
-            //Space
-            if(i == 26){
-                return (char) 32;
+        (void) pthread_mutex_lock(&pool->lock);
+        job->state = JOB_DONE;
+        (void) pthread_cond_broadcast(&pool->done);
+        (void) pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * @name        writeJob
+ * @brief       waits for a job and writes its output
+ * @param       pool the pool
+ * @param       index index of the job
+ * @param       fd file descriptor to write to
+ */
+static void writeJob(struct pool *pool, uint64_t index, int fd){
+
+    struct job *job = &pool->jobs[index % pool->njobs];
+
+    (void) pthread_mutex_lock(&pool->lock);
+    while(job->state != JOB_DONE){
+        (void) pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    (void) pthread_mutex_unlock(&pool->lock);
+
+    writeBlock(fd, job->out, job->outlength);
+    job->state = JOB_FREE;
+}
+
+/**
+ * @name        fillFindJob
+ * @brief       fills the input of a find job
+ * @param       in input buffer of the job, JOBSIZE bytes
+ * @param       leftover bytes after the last delimiter of the previous job
+ * @param       leftoverlength number of leftover bytes, updated for the next job
+ * @param       eof set to 1 when the end of the input is reached
+ * @return      number of bytes in the job, which end with a delimiter unless eof is set
+ * @detail      a word filling the whole buffer is no codeword, only its first MAXWORDLENGTH + 1 bytes are kept
+ */
+static size_t fillFindJob(char *in, char *leftover, size_t *leftoverlength, int *eof){
+
+    size_t length = *leftoverlength;
+
+    (void) memcpy(in, leftover, length);
+    *leftoverlength = 0;
+
+    for(;;){
+        size_t cut;
+
+        length += readFull(&in[length], JOBSIZE - length);
+        if(length < JOBSIZE){
+            *eof = 1;
+            return length;
+        }
+
+        for(cut = length; cut > 0; cut--){
+            const char c = in[cut - 1];
+            if(c == ' ' || c == '.' || c == '\n'){
+                break;
             }
+        }
 
-            return (char) i+97;
+        if(cut > 0){
+            *leftoverlength = length - cut;
+            (void) memcpy(leftover, &in[cut], *leftoverlength);
+            return cut;
         }
 
-        i++;
+        length = MAXWORDLENGTH + 1;
     }
+}
+
+/**
+ * @name        readFull
+ * @brief       reads from the standart input until a buffer is full or the input ends
+ * @param       buff the buffer
+ * @param       length size of the buffer
+ * @return      number of bytes read, less than length only at the end of the input
+ */
+static size_t readFull(char *buff, size_t length){
 
-    return '\0';
+    size_t filled = 0;
+
+    while(filled < length){
+        const size_t n = readSome(&buff[filled], length - filled);
+
+        if(n == 0){
+            break;
+        }
+
+        filled += n;
+    }
+
+    return filled;
 }
 
+/**
+ * @name        readSome
+ * @brief       reads once from the standart input
+ * @param       buff the buffer
+ * @param       length size of the buffer
+ * @return      number of bytes read, 0 at the end of the input
+ * @detail      counts the time and the bytes for --stats, exits with EXIT_FAILURE if reading fails
+ */
+static size_t readSome(char *buff, size_t length){
+
+    struct statsTimer timer;
+    ssize_t n;
+
+    //Bytes of peekIdx() first
+    if(peekedoffset < peekedlength){
+        n = (ssize_t) (peekedlength - peekedoffset < length ? peekedlength - peekedoffset : length);
+        (void) memcpy(buff, &peeked[peekedoffset], (size_t) n);
+        peekedoffset += (size_t) n;
+        return (size_t) n;
+    }
+
+    statsBegin(&timer);
+    while((n = read(STDIN_FILENO, buff, length)) < 0){
+        if(errno == EINTR) continue;
+        (void) fprintf(stderr, "%s: read: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    statsEnd(&timer, STATS_READ);
+    statsBytesIn((uint64_t) n);
+
+    return (size_t) n;
+}
 
 /**
- * @name    encryptChar
- * @brief   encrypts a single character
- * @param   plain the character which should be encrypted
- * @return  encrypted string
- * @detail  decrypts a single character according to the chiffre array
+ * @name        peekIdx
+ * @brief       checks whether the standart input is in the idx form
+ * @return      1 if the input starts with STEGIT_IDXMAGIC, which is consumed, 0 otherwise
+ * @detail      the bytes read from other input are returned again by the next reads
  */
-const char* encryptChar(char plain){
+static int peekIdx(void){
 
-    //ASCII Table under https://www.uni-due.de/hummell/infos/ascii/
+    peekedlength = readFull(peeked, sizeof(peeked));
+    peekedoffset = 0;
 
-    //Dot
-    if(plain == 46){
-        return chiffre[27];
+    if(peekedlength == sizeof(STEGIT_IDXMAGIC) && memcmp(peeked, STEGIT_IDXMAGIC, peekedlength) == 0){
+        peekedlength = 0;
+        return 1;
     }
 
-    //Space
-    if(plain == 32){
-        return chiffre[26];
+    return 0;
+}
+
+/**
+ * @name        runPipeline
+ * @brief       hides or finds text from the standart input on three threads
+ * @param       hide 1 for hide mode, 0 for find mode
+ * @detail      A reader, a codec and a writer thread pass PIPEBUFFERS input and PIPEBUFFERS output buffers
+ *              through single producer single consumer rings, so reading, encoding and writing overlap and
+ *              nothing is allocated after startup. The output is the same as that of encryptText() and
+ *              decryptText().
+ */
+void runPipeline(int hide){
+
+    static struct pipeline pipe;
+    static struct buffer in[PIPEBUFFERS];
+    static struct buffer out[PIPEBUFFERS];
+    pthread_t reader;
+    pthread_t codec;
+    pthread_t writer;
+    size_t outsize;
+
+    stegitInit(&pipe.ctx, book);
+    pipe.hide = hide;
+    outsize = hide ? stegitEncodeBound(&pipe.ctx, INBUFFERSIZE) : INBUFFERSIZE + 1;
+
+    ringInit(&pipe.inFull);
+    ringInit(&pipe.inFree);
+    ringInit(&pipe.outFull);
+    ringInit(&pipe.outFree);
+
+    for(int i = 0; i < PIPEBUFFERS; i++){
+        in[i].data = malloc(INBUFFERSIZE);
+        out[i].data = malloc(outsize);
+        if(in[i].data == NULL || out[i].data == NULL){
+            (void) fprintf(stderr, "%s: malloc: %s\n", command, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        ringPush(&pipe.inFree, &in[i]);
+        ringPush(&pipe.outFree, &out[i]);
     }
 
-    //Upper char
-    if(plain >= 65 && plain <= 90){
-        return chiffre[plain-65];
+    if(pthread_create(&reader, NULL, pipeReader, &pipe) != 0 ||
+       pthread_create(&codec, NULL, pipeCodec, &pipe) != 0 ||
+       pthread_create(&writer, NULL, pipeWriter, &pipe) != 0){
+        (void) fprintf(stderr, "%s: pthread_create failed\n", command);
+        exit(EXIT_FAILURE);
     }
 
-    //Lower char
-    if(plain >= 97 && plain <= 122){
-        return chiffre[plain - 97];
+    (void) pthread_join(codec, NULL);
+    (void) pthread_join(writer, NULL);
+
+    //The reader may still wait for input nobody needs
+    (void) pthread_cancel(reader);
+    (void) pthread_join(reader, NULL);
+
+    for(int i = 0; i < PIPEBUFFERS; i++){
+        free(in[i].data);
+        free(out[i].data);
     }
+}
+
+/**
+ * @name        pipeReader
+ * @brief       reader thread of runPipeline()
+ * @param       arg the pipeline
+ * @return      NULL
+ * @detail      hands every read() to the codec as soon as it returns, an empty buffer marks the end of the input
+ */
+static void *pipeReader(void *arg){
+
+    struct pipeline *pipe = arg;
+    struct buffer *buff;
+    size_t n;
+
+    do{
+        buff = ringPop(&pipe->inFree);
+
+        if(__atomic_load_n(&pipe->stop, __ATOMIC_ACQUIRE)){
+            n = 0;
+        }else{
+            n = readSome(buff->data, INBUFFERSIZE);
+        }
+
+        buff->length = n;
+        buff->last = n == 0;
+        ringPush(&pipe->inFull, buff);
+    }while(n != 0);
+
+    return NULL;
+}
+
+/**
+ * @name        pipeCodec
+ * @brief       codec thread of runPipeline()
+ * @param       arg the pipeline
+ * @return      NULL
+ * @detail      encodes or decodes one input buffer into one output buffer, stops the reader when the hidden
+ *              message ended
+ */
+static void *pipeCodec(void *arg){
+
+    struct pipeline *pipe = arg;
+    struct statsTimer timer;
+    int last;
+
+    do{
+        struct buffer *in = ringPop(&pipe->inFull);
+        struct buffer *out = ringPop(&pipe->outFree);
+
+        statsBegin(&timer);
+        if(pipe->hide){
+            out->length = stegitEncode(&pipe->ctx, in->data, in->length, out->data);
+        }else if(in->last){
+            out->length = stegitFinish(&pipe->ctx, out->data);
+        }else{
+            out->length = stegitDecode(&pipe->ctx, in->data, in->length, out->data);
+        }
+        statsCollect(&pipe->ctx.counters);
+        statsEnd(&timer, STATS_CODEC);
+
+        last = in->last || pipe->ctx.end;
+        if(pipe->ctx.end){
+            __atomic_store_n(&pipe->stop, 1, __ATOMIC_RELEASE);
+        }
+
+        out->last = last;
+        ringPush(&pipe->inFree, in);
+        ringPush(&pipe->outFull, out);
+    }while(!last);
+
+    return NULL;
+}
+
+/**
+ * @name        pipeWriter
+ * @brief       writer thread of runPipeline()
+ * @param       arg the pipeline
+ * @return      NULL
+ */
+static void *pipeWriter(void *arg){
+
+    struct pipeline *pipe = arg;
+    const int outfd = fileno(stdout);
+    int last;
+
+    do{
+        struct buffer *out = ringPop(&pipe->outFull);
+
+        writeBlock(outfd, out->data, out->length);
+        last = out->last;
+        ringPush(&pipe->outFree, out);
+    }while(!last);
+
+    return NULL;
+}
+
+/**
+ * @name        ringInit
+ * @brief       initializes an empty ring
+ * @param       ring the ring
+ */
+static void ringInit(struct ring *ring){
+
+    ring->head = 0;
+    ring->tail = 0;
+    if(sem_init(&ring->items, 0, 0) != 0){
+        (void) fprintf(stderr, "%s: sem_init: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @name        ringPush
+ * @brief       appends a buffer to a ring, producer side
+ * @param       ring the ring
+ * @param       buff the buffer
+ * @detail      never blocks, a ring can hold all PIPEBUFFERS buffers of its kind
+ */
+static void ringPush(struct ring *ring, struct buffer *buff){
+
+    const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    ring->slots[head % PIPEBUFFERS] = buff;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    (void) sem_post(&ring->items);
+}
+
+/**
+ * @name        ringPop
+ * @brief       removes the oldest buffer from a ring, consumer side
+ * @param       ring the ring
+ * @return      the buffer
+ * @detail      only sleeps while the ring is empty, sem_wait() does not enter the kernel otherwise
+ */
+static struct buffer *ringPop(struct ring *ring){
+
+    const uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    struct buffer *buff;
+
+    while(sem_wait(&ring->items) != 0){
+        if(errno == EINTR) continue;
+        (void) fprintf(stderr, "%s: sem_wait: %s\n", command, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    buff = ring->slots[tail % PIPEBUFFERS];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return buff;
+}
+
+/**
+ * @name        jobSeed
+ * @brief       seed of the dot stream of a hide job
+ * @param       seed the seed given with --seed
+ * @param       index index of the job
+ * @return      seed xor the splitmix64 output of index
+ */
+static uint64_t jobSeed(uint64_t seed, uint64_t index){
+
+    uint64_t z = index + 0x9e3779b97f4a7c15ull;
 
-    //any other char
-    return "";
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return seed ^ z ^ (z >> 31);
 }
 
 /**
@@ -272,9 +1351,22 @@ const char* encryptChar(char plain){
  * @details allways exits with EXIT_FAILURE
  */
 static void usage(void) {
-    (void) fprintf(stderr,"Usage: %s -f|-h [-o <filename>]\n",command);
+    (void) fprintf(stderr,"Usage: %s -f|-h [-o <filename>] [-c <codebook>] [-p | -j <threads>] [--seed <seed>] [--format=text|idx] [--stats[=json]]\n",command);
+    (void) fprintf(stderr,"       %s -f --range <start>:<length> [--index=<file>] [-o <filename>] [-c <codebook>]\n",command);
+    (void) fprintf(stderr,"       %s render [-o <filename>] [-c <codebook>]\n",command);
+    (void) fprintf(stderr,"       %s index --index=<file>\n",command);
     (void) fprintf(stderr,"\t-f\t\tfind mode\n");
     (void) fprintf(stderr,"\t-h\t\thide mode\n");
     (void) fprintf(stderr,"\t[-o <filename>]\t\toutput filename\n");
+    (void) fprintf(stderr,"\t[-c <codebook>]\t\ttext or compiled codebook, text codebooks are cached in <codebook>.bin\n");
+    (void) fprintf(stderr,"\t[-p]\t\tread, encode and write on three threads, same output as without -p\n");
+    (void) fprintf(stderr,"\t[-j <threads>]\t\tsplit the input into chunks processed by <threads> worker threads\n");
+    (void) fprintf(stderr,"\t[--seed <seed>]\t\tseed of the dot positions, the output does not depend on -j\n");
+    (void) fprintf(stderr,"\t[--format=idx]\t\thide mode writes packed codeword indices, find mode reads both forms\n");
+    (void) fprintf(stderr,"\t[--index=<file>]\t\tseek index, written in hide mode and read by --range\n");
+    (void) fprintf(stderr,"\t[--range <start>:<length>]\t\tfinds only <length> bytes from plain text offset <start>\n");
+    (void) fprintf(stderr,"\t[--stats[=json]]\t\treport counters and times per stage to stderr, SIGUSR1 shows progress\n");
+    (void) fprintf(stderr,"\trender\t\texpands the idx form into the text form\n");
+    (void) fprintf(stderr,"\tindex\t\tbuilds the seek index of the text form\n");
     exit(EXIT_FAILURE);
 }
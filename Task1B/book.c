@@ -0,0 +1,84 @@
+/**
+ * @file    book.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the book module
+ **/
+
+#include "book.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Answers are red | white << SHIFT_WIDTH */
+#define ANSWER_MASK (0x3f)
+
+int book_open(struct book *book, const char *path)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    (void) memset(book, 0, sizeof(*book));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct book_header)) {
+        (void) close(fd);
+        return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    book->header = map;
+    book->nodes = (const struct book_node *) (book->header + 1);
+    book->size = st.st_size;
+
+    if (memcmp(book->header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0
+        || book->header->version != BOOK_VERSION
+        || book->header->slots != SLOTS || book->header->colors != COLORS
+        || book->header->nodes == 0
+        || (book->size - sizeof(struct book_header)) / sizeof(struct book_node) < book->header->nodes) {
+        book_close(book);
+        return -1;
+    }
+
+    /* the whole tree is walked by every game */
+    (void) madvise(map, book->size, MADV_WILLNEED);
+    return 0;
+}
+
+void book_close(struct book *book)
+{
+    if (book->header != NULL) {
+        (void) munmap((void *) book->header, book->size);
+    }
+    (void) memset(book, 0, sizeof(*book));
+}
+
+const struct book_node *book_root(const struct book *book)
+{
+    return &book->nodes[0];
+}
+
+const struct book_node *book_child(const struct book *book, const struct book_node *node, uint8_t answer)
+{
+    const uint64_t bit = 1ull << (answer & ANSWER_MASK);
+    uint64_t index;
+
+    if ((node->answers & bit) == 0) {
+        return NULL;
+    }
+    index = (uint64_t) node->children + __builtin_popcountll(node->answers & (bit - 1));
+    if (index >= book->header->nodes) {
+        return NULL;
+    }
+    return &book->nodes[index];
+}
@@ -0,0 +1,84 @@
+/**
+ * @file    book.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Opening book of the mastermind client
+ * @details A book is the decision tree of the solver, written by mm-book and mapped into memory by the client.
+ * The file is a struct book_header followed by an array of struct book_node, the root is node 0. Every node
+ * holds the guess to play and a bit for every answer which leads to another node. The children of a node are
+ * stored next to each other in the order of their answers, so the child of an answer is found by counting the
+ * bits below it. Answers without a bit are either the end of the game or off the tree.
+ **/
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mastermind-common.h"
+
+#define BOOK_MAGIC ("MMBOOK1")
+#define BOOK_VERSION (1)
+
+/**
+ * @brief header of a book file
+ */
+struct book_header {
+    char magic[8];
+    uint32_t version;
+    uint16_t slots;             /**< SLOTS of the generator */
+    uint16_t colors;            /**< COLORS of the generator */
+    uint32_t nodes;             /**< number of nodes */
+    uint32_t depth;             /**< rounds covered by the book */
+};
+
+/**
+ * @brief a state of the game
+ */
+struct book_node {
+    uint64_t answers;           /**< bit a is set if answer a has a child */
+    uint32_t children;          /**< index of the first child */
+    uint16_t guess;             /**< code of the guess */
+    uint16_t reserved;
+};
+
+/**
+ * @brief a mapped book
+ */
+struct book {
+    const struct book_header *header;
+    const struct book_node *nodes;
+    size_t size;                /**< bytes mapped */
+};
+
+/**
+ * @brief Maps a book into memory
+ * @param book the book
+ * @param path file name
+ * @return 0 on success, -1 if the file can not be mapped or does not fit this build
+ */
+int book_open(struct book *book, const char *path);
+
+/**
+ * @brief Unmaps a book
+ * @param book the book
+ */
+void book_close(struct book *book);
+
+/**
+ * @brief The node of the first round
+ * @param book the book
+ * @return the node
+ */
+const struct book_node *book_root(const struct book *book);
+
+/**
+ * @brief The node after an answer
+ * @param book the book
+ * @param node the current node
+ * @param answer answer to the guess of the node, the error bits are ignored
+ * @return the next node, NULL if the answer leads off the tree
+ */
+const struct book_node *book_child(const struct book *book, const struct book_node *node, uint8_t answer);
+
+#endif // BOOK_H
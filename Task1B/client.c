@@ -5,7 +5,8 @@
  * @Author  Yannick Schwarenthorer, 1229026
  * @date    11. April 2016
  * @brief   Client for mastermind
- * @detail  This client tries to guess the right combination (currently only static tries)
+ * @detail  This client guesses the right combination, see solver.h for the strategy.
+ *          With an opening book from mm-book it plays the first rounds by lookup.
  */
 
 #include <stdio.h>
@@ -14,32 +15,21 @@
 #include <string.h>
 #include <strings.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <netdb.h>
-
-#define MAX_TRIES (35)
-#define SLOTS (5)
+#include "mastermind-common.h"
+#include "connection.h"
+#include "solver.h"
+#include "book.h"
+#include "score.h"
 
 #define EXIT_PARITY_ERROR (2)
 #define EXIT_GAME_LOST (3)
 #define EXIT_MULTIPLE_ERRORS (4)
 
-/* === Macros === */
-
-#ifdef ENDEBUG
-#define DEBUG(...) do { fprintf(stderr, __VA_ARGS__); } while(0)
-#else
-#define DEBUG(...)
-#endif
-
-/* Length of an array */
-#define COUNT_OF(x) (sizeof(x)/sizeof(x[0]))
-
 /* === Global Variables === */
 
-extern int errno;
-
 /* Name of the program */
 static const char *progname = "client"; /* default name */
 
@@ -51,6 +41,22 @@ static int connfd = -1;
 
 int roundNumber = 0;
 
+/* Codes which are still possible */
+static struct solver solver;
+
+/* Threads evaluating guesses */
+static struct solver_pool *pool = NULL;
+
+/* Opening book and the node of the current round, NULL when off the book */
+static struct book book;
+static const struct book_node *node = NULL;
+
+/* Guesses and answers so far, the solver is only updated when needed */
+static uint16_t guesses[MAX_TRIES];
+static uint8_t answers[MAX_TRIES];
+static int played = 0;
+static int applied = 0;
+
 enum { beige, darkblue, green, orange, red, black, violet, white };
 
 /* === Prototypes === */
@@ -67,25 +73,23 @@ static void bail_out(int exitcode, const char *fmt, ...);
  */
 static void free_resources(void);
 
-/**
- * @brief Creates the connection to server
- * @details Creates the connection to the given server on the given port
- * @param hostname the hostname of the server
- * @param port the portname of the server
- * @return the filedescriptor if connected successfully
- */
-int createConnection(const char *hostname, const int port);
-
 /**
  * @brief Generates and returns the next guess
  * @return the next guess
  */
 uint16_t nextGuess();
 
+/**
+ * @brief Takes note of the answer to a guess
+ * @param guess the guess, without parity
+ * @param answer the answer
+ */
+void recordAnswer(uint16_t guess, uint8_t answer);
+
 /**
  * @brief Calculates the parity bit for a color scheme
  * @param color the color scheme
- * @return the paritybit
+ * @return the paritybit at its position in the request
  * @details the parity bit will be calculatted by connecting all the bits from the color with a XOR
  */
 uint16_t getParity(uint16_t color);
@@ -98,40 +102,82 @@ uint16_t getParity(uint16_t color);
  * error, EXIT_GAME_LOST in case client needed to many guesses,
  * EXIT_MULTIPLE_ERRORS in case multiple errors occured in one round
  */
-int main(int argc, const char * argv[]) {
+int main(int argc, char * argv[]) {
 
     if(argc > 0) progname = argv[0];
 
-    //Handle args
-    if (argc != 3) {
+    //Handle args, evaluate guesses on all cores by default
+    char *ptr;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int c;
+
+    const char *bookpath = NULL;
+
+    while ((c = getopt(argc, argv, "b:t:")) != -1) {
+        switch (c) {
+            case 'b':
+                bookpath = optarg;
+                break;
+            case 't':
+                threads = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || threads < 1 || threads > 1024) {
+                    bail_out(EXIT_FAILURE, "<threads> has to be between 1 and 1024");
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-b book] [-t threads] <server-hostname> <server-port>\n", progname);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2) {
         errno = 0;
-        fprintf(stderr, "Usage: %s <server-hostname> <server-port>\n", progname);
+        fprintf(stderr, "Usage: %s [-b book] [-t threads] <server-hostname> <server-port>\n", progname);
         return EXIT_FAILURE;
     }
 
     //Read out and check port
-    char *ptr;
-    int port = strtol(argv[2],&ptr,10);
+    int port = strtol(argv[optind + 1],&ptr,10);
     if(port > 65535 || port < 1){
         bail_out(EXIT_FAILURE,"Port must be in the TCP/IP port range (1.65535)");
     }
 
-    connfd = createConnection(argv[1],port);
+    if (bookpath != NULL) {
+        if (book_open(&book, bookpath) < 0) {
+            bail_out(EXIT_FAILURE, "Can not use book %s", bookpath);
+        }
+        node = book_root(&book);
+    }
+
+    connfd = create_connection(argv[optind],port);
+    if (connfd < 0) {
+        bail_out(EXIT_FAILURE, "No address for valid socket found");
+    }
+
+    pool = solver_pool_create(threads < 1 ? 1 : (int) threads);
+    if (pool == NULL) {
+        bail_out(EXIT_FAILURE, "solver_pool_create");
+    }
 
     //Game start
     uint8_t result;
     uint16_t guess;
 
+    solver_init(&solver);
+
     while(1){
         roundNumber++;
 
         //Send guess
         guess = nextGuess();
-        send(connfd,&guess,2,0);
+        if (send(connfd,&guess,2,0) != 2) {
+            bail_out(EXIT_FAILURE, "send");
+        }
         DEBUG("Sent 0x%x\n", guess);
 
         //Get result
-        recv(connfd, &result, 1, 0);
+        if (recv(connfd, &result, 1, MSG_WAITALL) != 1) {
+            bail_out(EXIT_FAILURE, "recv");
+        }
         DEBUG("Got byte 0x%x\n", result);
 
 
@@ -152,86 +198,54 @@ int main(int argc, const char * argv[]) {
         }
 
         // Check if game is won
-        if ((result & 7) == 5 ) {
+        if ((result & 7) == SLOTS ) {
             printf("Runden: %d\n", roundNumber);
             return 0;
         }
+
+        recordAnswer(guess & CODE_MASK, result);
     }
 
     return 1;
 }
 
 uint16_t nextGuess(){
-    uint16_t color = 0x0000;
-    return color | getParity(color);
-}
-
-uint16_t getParity(uint16_t color){
+    int color;
 
-    uint16_t parity = 0;
-
-    uint16_t one = 1;
-
-    for(int x = 0; x < 14; x++){
-        parity ^= (color ^ one);
-        one <<= 1;
+    if (node != NULL) {
+        color = node->guess & CODE_MASK;
+        return (uint16_t) color | getParity((uint16_t) color);
     }
 
-    return parity;
-}
-
-
-
-int createConnection(const char *hostname, const int port){
-
-    int sock = 0;
-    int success = 0;
-
-    //Port
-    char port_string[6];
-    sprintf(port_string,"%i",port);
-
-    //Address info
-    struct addrinfo *ai = malloc(sizeof(struct addrinfo));
-    struct addrinfo hints;
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-    hints.ai_addrlen = 0;
-    hints.ai_addr = NULL;
-    hints.ai_canonname = NULL;
-    hints.ai_next = NULL;
-
-    if (getaddrinfo(hostname, port_string, &hints, &ai) != 0) {
-        bail_out(EXIT_FAILURE, "getaddrinfo");
+    /* off the book, catch up with the answers */
+    for (; applied < played; applied++) {
+        solver_update(&solver, guesses[applied], answers[applied]);
     }
+    color = solver_next_parallel(&solver, pool);
 
-    struct addrinfo *ai_head = ai;
-
-    if (ai == NULL) {
-        bail_out(EXIT_FAILURE, "Address infromation is empty");
+    if (color < 0) {
+        bail_out(EXIT_FAILURE, "No sequence fits the answers of the server");
     }
+    return (uint16_t) color | getParity((uint16_t) color);
+}
 
-    do {
-        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-        if (sock >= 0) {
-            if (connect(sock, ai->ai_addr, ai->ai_addrlen) >= 0){
-                success = 1;
-                break;
-            }
-        }
-    } while ((ai = ai->ai_next) != NULL);
-
-    freeaddrinfo(ai_head);
-
-    if (success == 0) {
-        bail_out(EXIT_FAILURE, "No address for valid socket found");
+void recordAnswer(uint16_t guess, uint8_t answer){
+    if (played < MAX_TRIES) {
+        guesses[played] = guess;
+        answers[played] = answer;
+        played++;
+    }
+    if (node != NULL) {
+        node = book_child(&book, node, answer);
     }
+}
 
-    return sock;
+uint16_t getParity(uint16_t color){
+    return score_parity(color);
 }
 
 
+
 static void free_resources(void)
 {
     /* clean up resources */
@@ -242,6 +256,10 @@ static void free_resources(void)
     if(sockfd >= 0) {
         (void) close(sockfd);
     }
+    solver_pool_destroy(pool);
+    pool = NULL;
+    book_close(&book);
+    node = NULL;
 }
 
 static void bail_out(int exitcode, const char *fmt, ...)
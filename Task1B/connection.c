@@ -0,0 +1,78 @@
+/**
+ * @file    connection.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the connection module
+ **/
+
+#include "connection.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+/**
+ * @brief Looks up all addresses of a server
+ * @param hostname the hostname of the server
+ * @param port the port of the server
+ * @return list of addresses, to be freed with freeaddrinfo(), NULL on error
+ */
+static struct addrinfo *lookup(const char *hostname, int port);
+
+static struct addrinfo *lookup(const char *hostname, int port)
+{
+    struct addrinfo *ai = NULL;
+    struct addrinfo hints;
+    char port_string[6];
+
+    //Port
+    (void) snprintf(port_string, sizeof(port_string), "%i", port);
+
+    //Address info
+    (void) memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    if (getaddrinfo(hostname, port_string, &hints, &ai) != 0) {
+        return NULL;
+    }
+    return ai;
+}
+
+int resolve_address(const char *hostname, int port, struct sockaddr_storage *address, socklen_t *length)
+{
+    struct addrinfo *ai = lookup(hostname, port);
+
+    if (ai == NULL) {
+        return -1;
+    }
+    (void) memcpy(address, ai->ai_addr, ai->ai_addrlen);
+    *length = ai->ai_addrlen;
+    freeaddrinfo(ai);
+    return 0;
+}
+
+int create_connection(const char *hostname, int port)
+{
+    struct addrinfo *ai_head = lookup(hostname, port);
+    struct addrinfo *ai;
+    int sock = -1;
+
+    for (ai = ai_head; ai != NULL; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock >= 0) {
+            if (connect(sock, ai->ai_addr, ai->ai_addrlen) >= 0) {
+                break;
+            }
+            (void) close(sock);
+            sock = -1;
+        }
+    }
+
+    if (ai_head != NULL) {
+        freeaddrinfo(ai_head);
+    }
+    return sock;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file    connection.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Connection setup of the mastermind clients
+ **/
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Looks up the address of a server
+ * @param hostname the hostname of the server
+ * @param port the port of the server
+ * @param address the first TCP/IPv4 address found
+ * @param length length of the address
+ * @return 0 on success, -1 if the host can not be found
+ */
+int resolve_address(const char *hostname, int port, struct sockaddr_storage *address, socklen_t *length);
+
+/**
+ * @brief Creates the connection to a server
+ * @details tries all addresses of the server until one accepts the connection
+ * @param hostname the hostname of the server
+ * @param port the port of the server
+ * @return the connected socket, -1 on error
+ */
+int create_connection(const char *hostname, int port);
+
+#endif // CONNECTION_H
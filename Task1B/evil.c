@@ -0,0 +1,208 @@
+/**
+ * @file    evil.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the evil module
+ **/
+
+#include "evil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief a guess prepared for scoring
+ */
+struct guess {
+    uint16_t code;
+    int slots;
+    uint8_t colors[EVIL_SLOTS];     /**< color in every slot */
+    int ncolors;                    /**< distinct colors */
+    uint8_t used[EVIL_SLOTS];       /**< the distinct colors */
+    uint8_t counts[EVIL_SLOTS];     /**< pegs of every distinct color */
+};
+
+/**
+ * @brief Scores the 64 codes of a word of a candidate set
+ * @param evil the planes
+ * @param guess the guess
+ * @param first first code of the word
+ * @param answers answers to the guess for the 64 codes
+ */
+static void score_word(const struct evil *evil, const struct guess *guess, uint32_t first, uint8_t *answers)
+{
+#ifdef __SSE2__
+    __m128i colors[EVIL_SLOTS];
+    __m128i counts[EVIL_SLOTS];
+
+    for (int j = 0; j < guess->slots; ++j) {
+        colors[j] = _mm_set1_epi8((char) guess->colors[j]);
+    }
+    for (int k = 0; k < guess->ncolors; ++k) {
+        counts[k] = _mm_set1_epi8((char) guess->counts[k]);
+    }
+    for (uint32_t b = 0; b < 64; b += 16) {
+        __m128i red = _mm_setzero_si128();
+        __m128i pins = _mm_setzero_si128();
+
+        /* a match is all ones, subtracting counts it */
+        for (int j = 0; j < guess->slots; ++j) {
+            __m128i code = _mm_loadu_si128((const __m128i *) (evil->colors[j] + first + b));
+
+            red = _mm_sub_epi8(red, _mm_cmpeq_epi8(code, colors[j]));
+        }
+        /* red and white pins of a color are the fewer pegs of guess and code */
+        for (int k = 0; k < guess->ncolors; ++k) {
+            __m128i code = _mm_loadu_si128((const __m128i *) (evil->counts[guess->used[k]] + first + b));
+
+            pins = _mm_add_epi8(pins, _mm_min_epu8(code, counts[k]));
+        }
+        /* white fits in the low bits of every byte, the 16 bit shift does not carry */
+        _mm_storeu_si128((__m128i *) (answers + b),
+            _mm_or_si128(red, _mm_slli_epi16(_mm_sub_epi8(pins, red), SHIFT_WIDTH)));
+    }
+#else
+    for (uint32_t i = 0; i < 64; ++i) {
+        answers[i] = evil->geometry->compute(guess->code, (uint16_t) (first + i));
+    }
+#endif
+}
+
+/**
+ * @brief Selects the codes of a word with an answer
+ * @param answers answers to the guess for the 64 codes of the word
+ * @param answer the answer
+ * @return bit i set if answers[i] is answer
+ */
+static uint64_t select_word(const uint8_t *answers, uint8_t answer)
+{
+    uint64_t mask = 0;
+
+#ifdef __SSE2__
+    const __m128i wanted = _mm_set1_epi8((char) answer);
+
+    for (uint32_t b = 0; b < 64; b += 16) {
+        __m128i got = _mm_loadu_si128((const __m128i *) (answers + b));
+
+        mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(got, wanted)) << b;
+    }
+#else
+    for (uint32_t i = 0; i < 64; ++i) {
+        mask |= (uint64_t) (answers[i] == answer) << i;
+    }
+#endif
+    return mask;
+}
+
+struct evil *evil_create(const struct score_geometry *geometry)
+{
+    const int shift = geometry->shift;
+    struct evil *evil;
+
+    if (shift != SHIFT_WIDTH || geometry->slots > EVIL_SLOTS || geometry->colors > EVIL_COLORS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    evil = calloc(1, sizeof(*evil));
+    if (evil == NULL) {
+        return NULL;
+    }
+    evil->geometry = geometry;
+
+    for (uint32_t code = 0; code < CODES; ++code) {
+        int valid = (code >> (geometry->slots * shift)) == 0;
+
+        for (int j = 0; j < geometry->slots; ++j) {
+            uint8_t color = (code >> (j * shift)) & ((1 << shift) - 1);
+
+            evil->colors[j][code] = color;
+            evil->counts[color][code]++;
+            if (color >= geometry->colors) {
+                valid = 0;
+            }
+        }
+        if (valid) {
+            evil->all.bits[code / 64] |= (uint64_t) 1 << (code % 64);
+            evil->all.count++;
+        }
+    }
+    return evil;
+}
+
+void evil_destroy(struct evil *evil)
+{
+    free(evil);
+}
+
+uint8_t evil_answer(const struct evil *evil, struct evil_set *set, uint16_t guess)
+{
+    const uint8_t win = (uint8_t) evil->geometry->slots;
+    uint8_t answers[CODES];
+    uint32_t sizes[4][EVIL_ANSWERS];
+    struct guess prepared;
+    uint32_t best_size = 0;
+    uint8_t best = win;
+    uint32_t n = 0;
+
+    /* split the guess into colors and color counts */
+    (void) memset(&prepared, 0, sizeof(prepared));
+    prepared.code = guess & (uint16_t) ((1u << (evil->geometry->slots * SHIFT_WIDTH)) - 1);
+    prepared.slots = evil->geometry->slots;
+    for (int j = 0; j < prepared.slots; ++j) {
+        uint8_t color = (prepared.code >> (j * SHIFT_WIDTH)) & ((1 << SHIFT_WIDTH) - 1);
+        int k;
+
+        prepared.colors[j] = color;
+        for (k = 0; k < prepared.ncolors && prepared.used[k] != color; ++k) {
+            continue;
+        }
+        if (k == prepared.ncolors) {
+            prepared.used[prepared.ncolors++] = color;
+        }
+        prepared.counts[k]++;
+    }
+
+    /* partition: four histograms, so that runs of one answer do not wait for each other */
+    (void) memset(sizes, 0, sizeof(sizes));
+    for (uint32_t w = 0; w < EVIL_WORDS; ++w) {
+        uint64_t bits = set->bits[w];
+
+        if (bits == 0) {
+            continue;
+        }
+        score_word(evil, &prepared, w * 64, answers + w * 64);
+        if (bits == UINT64_MAX) {
+            for (uint32_t i = 0; i < 64; i += 4) {
+                sizes[0][answers[w * 64 + i]]++;
+                sizes[1][answers[w * 64 + i + 1]]++;
+                sizes[2][answers[w * 64 + i + 2]]++;
+                sizes[3][answers[w * 64 + i + 3]]++;
+            }
+            continue;
+        }
+        for (; bits != 0; bits &= bits - 1) {
+            sizes[n++ & 3][answers[w * 64 + __builtin_ctzll(bits)]]++;
+        }
+    }
+
+    /* the largest part, a win only if nothing else is left */
+    for (uint32_t a = 0; a < EVIL_ANSWERS; ++a) {
+        uint32_t size = sizes[0][a] + sizes[1][a] + sizes[2][a] + sizes[3][a];
+
+        if (size > best_size || (size == best_size && size > 0 && best == win)) {
+            best_size = size;
+            best = (uint8_t) a;
+        }
+    }
+
+    for (uint32_t w = 0; w < EVIL_WORDS; ++w) {
+        if (set->bits[w] != 0) {
+            set->bits[w] &= select_word(answers + w * 64, best);
+        }
+    }
+    set->count = best_size;
+    return best;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file    evil.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Adversarial answers for the mastermind server
+ * @details An evil host never commits to a secret. It keeps the set of codes consistent with all answers so far
+ * and answers every guess with the answer shared by most of them, so a solver has to narrow down the largest
+ * possible set in every round.
+ *
+ * Candidate sets are bitsets of all CODES codes. Partitioning a set by the answers to a guess scores 16 codes at
+ * once with SSE2: every code is kept as byte planes, its color in every slot and its number of pegs of every
+ * color, so red pins are compares against the colors of the guess and red plus white pins are minimums with
+ * the color counts of the guess. Words of the bitset without candidates are skipped. Without SSE2 the codes are
+ * scored one by one with the kernel of the geometry.
+ **/
+
+#ifndef EVIL_H
+#define EVIL_H
+
+#include <stdint.h>
+#include "mastermind-common.h"
+#include "score.h"
+
+#define EVIL_WORDS (CODES / 64)                 /**< 64 bit words of a candidate set */
+#define EVIL_SLOTS (PARITY_BIT / SHIFT_WIDTH)   /**< most slots of a code */
+#define EVIL_COLORS (1 << SHIFT_WIDTH)          /**< most colors of a code */
+#define EVIL_ANSWERS (1 << (2 * SHIFT_WIDTH))   /**< red | white << SHIFT_WIDTH is below */
+
+/**
+ * @brief a set of codes
+ */
+struct evil_set {
+    uint64_t bits[EVIL_WORDS];  /**< code i is bit i % 64 of word i / 64 */
+    uint32_t count;             /**< codes in the set */
+};
+
+/**
+ * @brief all codes of a geometry as byte planes, shared read-only by all games
+ */
+struct evil {
+    const struct score_geometry *geometry;
+    struct evil_set all;                        /**< every code of the geometry */
+    uint8_t colors[EVIL_SLOTS][CODES];          /**< color of every code in a slot */
+    uint8_t counts[EVIL_COLORS][CODES];         /**< pegs of a color in every code */
+};
+
+/**
+ * @brief Builds the planes of a geometry
+ * @param geometry the geometry, its colors need SHIFT_WIDTH bits
+ * @return the planes, NULL on error with errno set
+ */
+struct evil *evil_create(const struct score_geometry *geometry);
+
+/**
+ * @brief Frees the planes
+ * @param evil the planes, may be NULL
+ */
+void evil_destroy(struct evil *evil);
+
+/**
+ * @brief Answers a guess like a host without a secret
+ * @details partitions the set by the answers to guess and keeps the largest part; of equal parts a win is
+ * picked last.
+ * @param evil the planes
+ * @param set codes consistent with the answers so far, not empty; reduced to those consistent with the new answer
+ * @param guess code of the guess, bits above the slots of the geometry are ignored
+ * @return red | white << SHIFT_WIDTH
+ */
+uint8_t evil_answer(const struct evil *evil, struct evil_set *set, uint16_t guess);
+
+#endif // EVIL_H
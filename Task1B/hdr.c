@@ -0,0 +1,110 @@
+/**
+ * @file    hdr.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the hdr module
+ **/
+
+#include "hdr.h"
+#include <string.h>
+
+#define HALF (HDR_SUB_BUCKETS / 2)
+
+/**
+ * @brief Bucket of a value
+ * @param value the value
+ * @return index into counts
+ */
+static unsigned int bucket(uint64_t value);
+
+/**
+ * @brief Highest value of a bucket
+ * @param index index into counts
+ * @return the value
+ */
+static uint64_t highest(unsigned int index);
+
+static unsigned int bucket(uint64_t value)
+{
+    unsigned int shift;
+
+    if (value < HDR_SUB_BUCKETS) {
+        return (unsigned int) value;
+    }
+    /* keep the top HDR_SUB_BITS bits of the value */
+    shift = 64 - __builtin_clzll(value) - HDR_SUB_BITS;
+    return HDR_SUB_BUCKETS + (shift - 1) * HALF + (unsigned int) ((value >> shift) - HALF);
+}
+
+static uint64_t highest(unsigned int index)
+{
+    unsigned int shift;
+
+    if (index < HDR_SUB_BUCKETS) {
+        return index;
+    }
+    shift = (index - HDR_SUB_BUCKETS) / HALF + 1;
+    return ((uint64_t) ((index - HDR_SUB_BUCKETS) % HALF + HALF + 1) << shift) - 1;
+}
+
+void hdr_init(struct hdr *hdr)
+{
+    (void) memset(hdr, 0, sizeof(*hdr));
+    hdr->min = UINT64_MAX;
+}
+
+void hdr_record(struct hdr *hdr, uint64_t value)
+{
+    hdr_record_n(hdr, value, 1);
+}
+
+void hdr_record_n(struct hdr *hdr, uint64_t value, uint64_t count)
+{
+    hdr->counts[bucket(value)] += count;
+    hdr->total += count;
+    hdr->sum += value * count;
+    if (value < hdr->min) {
+        hdr->min = value;
+    }
+    if (value > hdr->max) {
+        hdr->max = value;
+    }
+}
+
+void hdr_merge(struct hdr *hdr, const struct hdr *other)
+{
+    for (unsigned int i = 0; i < HDR_BUCKETS; ++i) {
+        hdr->counts[i] += other->counts[i];
+    }
+    hdr->total += other->total;
+    hdr->sum += other->sum;
+    if (other->min < hdr->min) {
+        hdr->min = other->min;
+    }
+    if (other->max > hdr->max) {
+        hdr->max = other->max;
+    }
+}
+
+uint64_t hdr_percentile(const struct hdr *hdr, double percentile)
+{
+    uint64_t rank;
+    uint64_t seen = 0;
+
+    if (hdr->total == 0) {
+        return 0;
+    }
+    rank = (uint64_t) (percentile / 100.0 * hdr->total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    for (unsigned int i = 0; i < HDR_BUCKETS; ++i) {
+        seen += hdr->counts[i];
+        if (seen >= rank) {
+            const uint64_t value = highest(i);
+            return value < hdr->max ? value : hdr->max;
+        }
+    }
+    return hdr->max;
+}
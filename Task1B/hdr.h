@@ -0,0 +1,68 @@
+/**
+ * @file    hdr.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   High dynamic range histograms
+ * @details Values below HDR_SUB_BUCKETS are counted exactly. Larger values are counted in buckets of
+ * HDR_SUB_BUCKETS / 2 per power of two, so every value is kept with a relative error below 2 / HDR_SUB_BUCKETS
+ * over the whole 64 bit range. Recording is a few instructions and histograms of several threads can be
+ * merged by adding their counts.
+ **/
+
+#ifndef HDR_H
+#define HDR_H
+
+#include <stdint.h>
+
+#define HDR_SUB_BITS (7)
+#define HDR_SUB_BUCKETS (1 << HDR_SUB_BITS)
+#define HDR_BUCKETS (HDR_SUB_BUCKETS + (64 - HDR_SUB_BITS) * (HDR_SUB_BUCKETS / 2))
+
+/**
+ * @brief a histogram
+ */
+struct hdr {
+    uint64_t counts[HDR_BUCKETS];
+    uint64_t total;             /**< number of values */
+    uint64_t sum;               /**< sum of all values */
+    uint64_t min;
+    uint64_t max;
+};
+
+/**
+ * @brief Empties a histogram
+ * @param hdr the histogram
+ */
+void hdr_init(struct hdr *hdr);
+
+/**
+ * @brief Counts a value
+ * @param hdr the histogram
+ * @param value the value
+ */
+void hdr_record(struct hdr *hdr, uint64_t value);
+
+/**
+ * @brief Counts a value several times
+ * @param hdr the histogram
+ * @param value the value
+ * @param count how often the value is counted
+ */
+void hdr_record_n(struct hdr *hdr, uint64_t value, uint64_t count);
+
+/**
+ * @brief Adds the values of a histogram to another one
+ * @param hdr the histogram
+ * @param other the values to add
+ */
+void hdr_merge(struct hdr *hdr, const struct hdr *other);
+
+/**
+ * @brief Value at a percentile
+ * @param hdr the histogram
+ * @param percentile between 0 and 100
+ * @return the highest value of the bucket of the percentile, 0 if the histogram is empty
+ */
+uint64_t hdr_percentile(const struct hdr *hdr, double percentile);
+
+#endif // HDR_H
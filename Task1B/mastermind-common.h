@@ -0,0 +1,50 @@
+/**
+ * @file    mastermind-common.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Constants and macros shared by the mastermind programs
+ * @details A client plays by sending 2 byte requests (little endian, the sequence in the low 15 bits and its
+ * parity in bit 15) and reading a 1 byte answer for each.
+ *
+ * Instead of its first request a client may send BATCH_HELLO. The server acknowledges with the single byte
+ * BATCH_ACK and from then on the client sends frames of 1 to MAX_BATCH guesses: a count byte followed by a
+ * sequence number byte and a request per guess. The server answers every frame with a count byte followed by
+ * the sequence number and answer byte of every guess it played. Guesses are played in order with the same
+ * rules as single requests, so guesses after the end of the game are left out of the answer. An older server
+ * answers the hello with a parity error, since the parity bit of BATCH_HELLO is wrong.
+ **/
+
+#ifndef MASTERMIND_COMMON_H
+#define MASTERMIND_COMMON_H
+
+/* === Constants === */
+#define MAX_TRIES (35)          /**< rounds a client has to find the secret */
+#define SLOTS (5)               /**< colors in a sequence, default geometry, see score.h */
+#define COLORS (8)              /**< number of different colors, default geometry */
+#define SHIFT_WIDTH (3)         /**< bits of a color in a request */
+
+#define CODES (1 << (SLOTS * SHIFT_WIDTH))     /**< number of different sequences */
+#define CODE_MASK (CODES - 1)                  /**< the sequence bits of a request */
+#define PARITY_BIT (SLOTS * SHIFT_WIDTH)       /**< position of the parity bit in a request */
+
+#define PARITY_ERR_BIT (6)      /**< set in the answer if the parity of the request was wrong */
+#define GAME_LOST_ERR_BIT (7)   /**< set in the answer of the last round if the secret was not found */
+
+#define BATCH_HELLO (0x7fff)    /**< first request of a batch client, all colors 7 with a wrong parity */
+#define BATCH_ACK (0x7f)        /**< answer to BATCH_HELLO, red and white can never both be 7 */
+#define MAX_BATCH (MAX_TRIES)   /**< most guesses in a frame */
+#define BATCH_GUESS_BYTES (3)   /**< sequence number and request */
+#define BATCH_ANSWER_BYTES (2)  /**< sequence number and answer */
+#define BATCH_FRAME_BYTES(count) (1 + (count) * BATCH_GUESS_BYTES)
+
+/* === Macros === */
+#ifdef ENDEBUG
+#define DEBUG(...) do { fprintf(stderr, __VA_ARGS__); } while(0)
+#else
+#define DEBUG(...)
+#endif
+
+/* Length of an array */
+#define COUNT_OF(x) (sizeof(x)/sizeof(x[0]))
+
+#endif // MASTERMIND_COMMON_H
@@ -0,0 +1,103 @@
+/**
+ * @file    metrics.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the metrics module
+ **/
+
+#include "metrics.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int metrics_create(struct metrics_file *file, const char *path, uint32_t workers)
+{
+    const size_t size = sizeof(struct metrics) * (workers + 1);
+    void *map;
+
+    (void) memset(file, 0, sizeof(*file));
+
+    if (path == NULL) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd < 0) {
+            return -1;
+        }
+        if (ftruncate(fd, size) < 0) {
+            (void) close(fd);
+            return -1;
+        }
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        (void) close(fd);
+    }
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    /* the header gets a whole slot, so that every worker starts on its own cache line */
+    file->header = map;
+    file->workers = (struct metrics *) map + 1;
+    file->size = size;
+
+    for (uint32_t i = 0; i < workers; ++i) {
+        hdr_init(&file->workers[i].service);
+    }
+    (void) memcpy(file->header->magic, METRICS_MAGIC, sizeof(METRICS_MAGIC));
+    file->header->version = METRICS_VERSION;
+    file->header->workers = workers;
+    file->header->max_tries = MAX_TRIES;
+    file->header->size = sizeof(struct metrics);
+    file->header->pid = getpid();
+    file->header->started = time(NULL);
+    return 0;
+}
+
+int metrics_open(struct metrics_file *file, const char *path)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    (void) memset(file, 0, sizeof(*file));
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct metrics)) {
+        (void) close(fd);
+        return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    file->header = map;
+    file->workers = (struct metrics *) map + 1;
+    file->size = st.st_size;
+
+    if (memcmp(file->header->magic, METRICS_MAGIC, sizeof(METRICS_MAGIC)) != 0
+        || file->header->version != METRICS_VERSION
+        || file->header->max_tries != MAX_TRIES
+        || file->header->size != sizeof(struct metrics)
+        || file->size / sizeof(struct metrics) < (size_t) file->header->workers + 1) {
+        metrics_close(file);
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_close(struct metrics_file *file)
+{
+    if (file->header != NULL) {
+        (void) munmap(file->header, file->size);
+    }
+    (void) memset(file, 0, sizeof(*file));
+}
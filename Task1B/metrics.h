@@ -0,0 +1,95 @@
+/**
+ * @file    metrics.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Live counters of the mastermind server
+ * @details Every worker of the server owns one struct metrics and is the only one writing to it, so counting
+ * needs no locks or atomic read-modify-write instructions. The counters live in a shared memory mapping of a
+ * stats file: a struct metrics_header followed by one struct metrics per worker. Other processes can map the
+ * file read-only (see mm-stats) at any time and sum up the workers; a single counter is always read whole,
+ * but the counters of a worker are not a consistent snapshot.
+ **/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mastermind-common.h"
+#include "hdr.h"
+
+#define METRICS_MAGIC ("MMSTAT1")
+#define METRICS_VERSION (2)
+
+/**
+ * @brief header of a stats file
+ */
+struct metrics_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t workers;           /**< number of struct metrics */
+    uint32_t max_tries;         /**< MAX_TRIES of the server */
+    uint32_t size;              /**< sizeof(struct metrics) */
+    int64_t pid;                /**< process id of the server */
+    int64_t started;            /**< start of the server, seconds since the epoch */
+};
+
+/**
+ * @brief counters of a worker
+ */
+struct metrics {
+    uint64_t active;                    /**< open connections */
+    uint64_t started;                   /**< connections accepted, every connection is a game */
+    uint64_t won;
+    uint64_t lost;                      /**< games lost after MAX_TRIES rounds */
+    uint64_t parity_errors;             /**< games ended by a parity error */
+    uint64_t idle_timeouts;             /**< games closed after waiting too long for a request */
+    uint64_t game_timeouts;             /**< games closed for taking too long in total */
+    uint64_t requests;                  /**< guesses answered */
+    uint64_t rounds[MAX_TRIES + 1];     /**< games won in a number of rounds */
+    struct hdr service;                 /**< nanoseconds from reading a request until its answer is sent */
+} __attribute__((aligned(64)));
+
+/**
+ * @brief a mapped stats file
+ */
+struct metrics_file {
+    struct metrics_header *header;
+    struct metrics *workers;            /**< header->workers entries */
+    size_t size;                        /**< bytes mapped */
+};
+
+/**
+ * @brief Creates the counters of a server
+ * @param file the counters
+ * @param path stats file, NULL to keep the counters in anonymous memory
+ * @param workers number of workers
+ * @return 0 on success, -1 on error
+ */
+int metrics_create(struct metrics_file *file, const char *path, uint32_t workers);
+
+/**
+ * @brief Maps the stats file of a running server for reading
+ * @param file the counters
+ * @param path stats file
+ * @return 0 on success, -1 if the file can not be mapped or does not fit this build
+ */
+int metrics_open(struct metrics_file *file, const char *path);
+
+/**
+ * @brief Unmaps the counters
+ * @param file the counters
+ */
+void metrics_close(struct metrics_file *file);
+
+/**
+ * @brief Reads a counter written by another thread or process
+ * @param counter the counter
+ * @return its value
+ */
+static inline uint64_t metrics_read(const uint64_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+#endif // METRICS_H
@@ -0,0 +1,261 @@
+/**
+ * name     mm-book
+ * @file    mm-book.c
+ *
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Opening book generator for the mastermind client
+ * @detail  Plays the solver against every answer the server can give and writes the
+ *          resulting decision tree to a book file, see book.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "mastermind-common.h"
+#include "solver.h"
+#include "book.h"
+
+/* === Constants === */
+
+#define INITIAL_NODES (1024)
+
+/* === Global Variables === */
+
+/* Name of the program */
+static const char *progname = "mm-book"; /* default name */
+
+/* The tree */
+static struct book_node *nodes = NULL;
+static uint32_t nnodes = 0;
+static uint32_t capacity = 0;
+
+/* Deepest round in the tree */
+static uint32_t reached = 0;
+
+/* Threads evaluating guesses */
+static struct solver_pool *pool = NULL;
+
+/* === Prototypes === */
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief free allocated resources
+ */
+static void free_resources(void);
+
+/**
+ * @brief Appends nodes to the tree
+ * @param count number of nodes
+ * @return index of the first node
+ */
+static uint32_t reserve(uint32_t count);
+
+/**
+ * @brief Fills a node and its subtree
+ * @param index index of the node
+ * @param state the game in this node
+ * @param round round of the node, starting at 1
+ * @param depth last round of the book
+ */
+static void expand(uint32_t index, const struct solver *state, uint32_t round, uint32_t depth);
+
+/**
+ * @brief Writes the tree to a file
+ * @param path file name
+ * @param depth last round of the book
+ */
+static void write_book(const char *path, uint32_t depth);
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error
+ */
+int main(int argc, char *argv[])
+{
+    struct solver state;
+    long depth = MAX_TRIES;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char *ptr;
+    int c;
+
+    if (argc > 0) progname = argv[0];
+
+    //Handle args
+    while ((c = getopt(argc, argv, "d:t:")) != -1) {
+        switch (c) {
+            case 'd':
+                depth = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || depth < 1 || depth > MAX_TRIES) {
+                    bail_out(EXIT_FAILURE, "<depth> has to be between 1 and %d", MAX_TRIES);
+                }
+                break;
+            case 't':
+                threads = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || threads < 1 || threads > 1024) {
+                    bail_out(EXIT_FAILURE, "<threads> has to be between 1 and 1024");
+                }
+                break;
+            default:
+                bail_out(EXIT_FAILURE, "Usage: %s [-d depth] [-t threads] <book-file>", progname);
+        }
+    }
+    if (argc - optind != 1) {
+        bail_out(EXIT_FAILURE, "Usage: %s [-d depth] [-t threads] <book-file>", progname);
+    }
+
+    pool = solver_pool_create(threads < 1 ? 1 : (int) threads);
+    if (pool == NULL) {
+        bail_out(EXIT_FAILURE, "solver_pool_create");
+    }
+
+    //Grow the tree from the start of a game
+    solver_init(&state);
+    (void) reserve(1);
+    expand(0, &state, 1, (uint32_t) depth);
+
+    write_book(argv[optind], reached);
+    DEBUG("%u nodes, %u rounds\n", nnodes, reached);
+
+    free_resources();
+    return EXIT_SUCCESS;
+}
+
+static uint32_t reserve(uint32_t count)
+{
+    const uint32_t first = nnodes;
+
+    if (nnodes + count > capacity) {
+        uint32_t grown = capacity == 0 ? INITIAL_NODES : capacity;
+        struct book_node *more;
+
+        while (nnodes + count > grown) {
+            grown *= 2;
+        }
+        more = realloc(nodes, grown * sizeof(*nodes));
+        if (more == NULL) {
+            bail_out(EXIT_FAILURE, "realloc");
+        }
+        nodes = more;
+        capacity = grown;
+    }
+
+    (void) memset(nodes + first, 0, count * sizeof(*nodes));
+    nnodes += count;
+    return first;
+}
+
+static void expand(uint32_t index, const struct solver *state, uint32_t round, uint32_t depth)
+{
+    struct solver next;
+    uint64_t answers = 0;
+    uint32_t first;
+    int guess;
+
+    guess = solver_next_parallel(state, pool);
+    if (guess < 0) {
+        bail_out(EXIT_FAILURE, "No sequence fits the answers in round %u", round);
+    }
+    nodes[index].guess = (uint16_t) guess;
+    if (round > reached) {
+        reached = round;
+    }
+    if (round == depth) {
+        return;
+    }
+
+    /* answers the consistent codes can give, except the end of the game */
+    for (uint32_t w = 0; w < CODES / 64; ++w) {
+        uint64_t bits = state->consistent[w];
+
+        while (bits != 0) {
+            const uint8_t answer = solver_score((uint16_t) guess, (uint16_t) (w * 64 + __builtin_ctzll(bits)));
+
+            if ((answer & (COLORS - 1)) != SLOTS) {
+                answers |= 1ull << answer;
+            }
+            bits &= bits - 1;
+        }
+    }
+    if (answers == 0) {
+        return;
+    }
+
+    /* nodes may move while the children are expanded */
+    first = reserve(__builtin_popcountll(answers));
+    nodes[index].answers = answers;
+    nodes[index].children = first;
+
+    for (int answer = 0; answer < SOLVER_ANSWERS; ++answer) {
+        if (answers & (1ull << answer)) {
+            next = *state;
+            solver_update(&next, (uint16_t) guess, (uint8_t) answer);
+            expand(first++, &next, round + 1, depth);
+        }
+    }
+}
+
+static void write_book(const char *path, uint32_t depth)
+{
+    struct book_header header;
+    FILE *file;
+
+    (void) memset(&header, 0, sizeof(header));
+    (void) memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = BOOK_VERSION;
+    header.slots = SLOTS;
+    header.colors = COLORS;
+    header.nodes = nnodes;
+    header.depth = depth;
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        bail_out(EXIT_FAILURE, "fopen %s", path);
+    }
+    if (fwrite(&header, sizeof(header), 1, file) != 1
+        || fwrite(nodes, sizeof(*nodes), nnodes, file) != nnodes) {
+        (void) fclose(file);
+        bail_out(EXIT_FAILURE, "fwrite %s", path);
+    }
+    if (fclose(file) != 0) {
+        bail_out(EXIT_FAILURE, "fclose %s", path);
+    }
+}
+
+static void free_resources(void)
+{
+    solver_pool_destroy(pool);
+    pool = NULL;
+    free(nodes);
+    nodes = NULL;
+}
+
+static void bail_out(int exitcode, const char *fmt, ...)
+{
+    va_list ap;
+
+    (void) fprintf(stderr, "%s: ", progname);
+    if (fmt != NULL) {
+        va_start(ap, fmt);
+        (void) vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    if (errno != 0) {
+        (void) fprintf(stderr, ": %s", strerror(errno));
+    }
+    (void) fprintf(stderr, "\n");
+
+    free_resources();
+    exit(exitcode);
+}
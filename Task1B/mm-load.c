@@ -0,0 +1,900 @@
+/**
+ * name     mm-load
+ * @file    mm-load.c
+ *
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Load generator for the mastermind server
+ * @detail  Keeps a number of connections busy with complete games, opening them
+ *          gradually during the ramp-up. Every connection starts a new game when
+ *          its last one ended. Games, requests and the time between a request and
+ *          its answer are counted after the ramp-up until the end of the run.
+ *          With -p every game starts with BATCH_HELLO and sends frames of up to
+ *          that many guesses: off the book, several consistent codes are played
+ *          at once, and all of them once they fit into a frame. A server which
+ *          answers the hello with a parity error gets the single requests from
+ *          then on; the refused game is not counted.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "mastermind-common.h"
+#include "connection.h"
+#include "solver.h"
+#include "book.h"
+#include "hdr.h"
+
+/* === Constants === */
+
+#define MAX_EVENTS (256)
+#define TICK_MS (5)                 /* how often connections are opened during the ramp-up */
+#define NANOSECONDS (1000000000ull)
+
+/* === Type Definitions === */
+
+/* How the next guess is chosen */
+enum strategy {
+    RANDOM,                         /* any code, most games are lost */
+    CONSISTENT,                     /* a random code which fits all answers */
+    BOOK                            /* the opening book, CONSISTENT off the book */
+};
+
+struct opts {
+    const char *hostname;
+    long int portno;
+    long int connections;
+    long int threads;
+    double duration;                /* seconds of measurement */
+    double rampup;                  /* seconds until all connections are open */
+    enum strategy strategy;
+    const char *bookpath;
+    long int pipeline;              /* most guesses per frame, 0 for single requests */
+};
+
+/* One connection */
+struct player {
+    int fd;                         /* -1 if closed */
+    int connected;
+    int round;
+    uint16_t guess;
+    int hello;                      /* BATCH_HELLO is waiting for its answer */
+    int batched;                    /* the server acknowledged the batch protocol */
+    uint16_t frame[MAX_BATCH];      /* guesses of the frame in flight, indexed by sequence number */
+    int framed;                     /* guesses in the frame */
+    uint8_t in[1 + MAX_BATCH * BATCH_ANSWER_BYTES];     /* answer of the frame so far */
+    size_t buffered;
+    uint64_t sent;                  /* time the request was sent */
+    const struct book_node *node;   /* NULL when off the book */
+    struct solver *solver;          /* codes which fit the answers, CONSISTENT and BOOK only */
+};
+
+/* A thread with its own connections and counters */
+struct loader {
+    pthread_t thread;
+    int epfd;
+    uint64_t rng;                   /* splitmix64 state */
+    struct player *players;
+    long int count;                 /* connections of this thread */
+    long int opened;                /* connections opened so far */
+    int classic;                    /* the server refused BATCH_HELLO */
+
+    uint64_t games;
+    uint64_t won;
+    uint64_t lost;
+    uint64_t errors;                /* parity errors, broken connections and failed connects */
+    uint64_t requests;
+    uint64_t rounds;                /* rounds of the games won */
+    struct hdr latency;             /* nanoseconds from request to answer */
+};
+
+/* === Global Variables === */
+
+/* Name of the program */
+static const char *progname = "mm-load"; /* default name */
+
+static struct opts options;
+static struct sockaddr_storage address;
+static socklen_t address_length;
+static struct book book;
+
+static struct loader *loaders = NULL;
+
+/* Phases of the run, in nanoseconds of CLOCK_MONOTONIC */
+static uint64_t started;
+static uint64_t measuring;
+static uint64_t stopping;
+
+/* === Prototypes === */
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param opts Struct where parsed arguments are stored
+ */
+static void parse_args(int argc, char **argv, struct opts *opts);
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief free allocated resources
+ */
+static void free_resources(void);
+
+/**
+ * @brief Current time
+ * @return nanoseconds of CLOCK_MONOTONIC
+ */
+static uint64_t now(void);
+
+/**
+ * @brief Entry point of a load thread
+ * @param arg the loader
+ * @return NULL
+ */
+static void *run(void *arg);
+
+/**
+ * @brief Opens a connection and starts a game on it
+ * @param loader the loader
+ * @param player the connection
+ */
+static void start_game(struct loader *loader, struct player *player);
+
+/**
+ * @brief Closes a connection
+ * @details a new game is started unless the run is over
+ * @param loader the loader
+ * @param player the connection
+ */
+static void end_game(struct loader *loader, struct player *player);
+
+/**
+ * @brief Handles an event of a connection
+ * @param loader the loader
+ * @param player the connection
+ * @param events the events
+ */
+static void handle_event(struct loader *loader, struct player *player, uint32_t events);
+
+/**
+ * @brief Handles the answer to BATCH_HELLO
+ * @param loader the loader
+ * @param player the connection
+ */
+static void handle_hello(struct loader *loader, struct player *player);
+
+/**
+ * @brief Reads the answer of a frame and plays it once it is complete
+ * @param loader the loader
+ * @param player the connection
+ * @param counting whether the run is measuring
+ */
+static void handle_frame(struct loader *loader, struct player *player, int counting);
+
+/**
+ * @brief Counts an answer and learns from it
+ * @param loader the loader
+ * @param player the connection
+ * @param guess the code of the guess
+ * @param answer the answer
+ * @param counting whether the run is measuring
+ * @return 0 if the game goes on, -1 if it is over
+ */
+static int apply_answer(struct loader *loader, struct player *player, uint16_t guess, uint8_t answer,
+                        int counting);
+
+/**
+ * @brief Chooses the next guess
+ * @param loader the loader
+ * @param player the connection
+ * @return the code of the guess
+ */
+static uint16_t choose_guess(struct loader *loader, struct player *player);
+
+/**
+ * @brief The k-th consistent code
+ * @param solver the solver, k below its remaining codes
+ * @param k the index
+ * @return the code
+ */
+static uint16_t consistent_code(const struct solver *solver, uint64_t k);
+
+/**
+ * @brief Chooses and sends the next guess
+ * @param loader the loader
+ * @param player the connection
+ * @return 0 on success, -1 on error
+ */
+static int send_guess(struct loader *loader, struct player *player);
+
+/**
+ * @brief Chooses and sends the guesses of the next frame
+ * @details on the book the frame holds its one guess, off the book up to options.pipeline distinct codes
+ * @param loader the loader
+ * @param player the connection
+ * @return 0 on success, -1 on error
+ */
+static int send_frame(struct loader *loader, struct player *player);
+
+/**
+ * @brief Builds a request
+ * @param guess the code of the guess
+ * @return the guess with its parity bit
+ */
+static uint16_t make_request(uint16_t guess);
+
+/**
+ * @brief Draws a random number
+ * @param loader the loader
+ * @return the number
+ */
+static uint64_t draw(struct loader *loader);
+
+/**
+ * @brief Prints the merged results
+ * @param elapsed nanoseconds of measurement
+ */
+static void report(uint64_t elapsed);
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error
+ */
+int main(int argc, char *argv[])
+{
+    uint64_t elapsed;
+
+    parse_args(argc, argv, &options);
+
+    if (resolve_address(options.hostname, options.portno, &address, &address_length) < 0) {
+        bail_out(EXIT_FAILURE, "Can not resolve %s", options.hostname);
+    }
+    if (options.strategy == BOOK && book_open(&book, options.bookpath) < 0) {
+        bail_out(EXIT_FAILURE, "Can not use book %s", options.bookpath);
+    }
+
+    loaders = calloc(options.threads, sizeof(*loaders));
+    if (loaders == NULL) {
+        bail_out(EXIT_FAILURE, "calloc");
+    }
+    for (long int i = 0; i < options.threads; ++i) {
+        struct loader *loader = &loaders[i];
+
+        loader->epfd = -1;
+        loader->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+        loader->count = options.connections / options.threads + (i < options.connections % options.threads);
+        hdr_init(&loader->latency);
+        loader->players = calloc(loader->count, sizeof(*loader->players));
+        if (loader->players == NULL) {
+            bail_out(EXIT_FAILURE, "calloc");
+        }
+        for (long int j = 0; j < loader->count; ++j) {
+            loader->players[j].fd = -1;
+            if (options.strategy != RANDOM) {
+                loader->players[j].solver = malloc(sizeof(struct solver));
+                if (loader->players[j].solver == NULL) {
+                    bail_out(EXIT_FAILURE, "malloc");
+                }
+            }
+        }
+        loader->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (loader->epfd < 0) {
+            bail_out(EXIT_FAILURE, "epoll_create1");
+        }
+    }
+
+    started = now();
+    measuring = started + (uint64_t) (options.rampup * NANOSECONDS);
+    stopping = measuring + (uint64_t) (options.duration * NANOSECONDS);
+
+    for (long int i = 0; i < options.threads; ++i) {
+        errno = pthread_create(&loaders[i].thread, NULL, run, &loaders[i]);
+        if (errno != 0) {
+            bail_out(EXIT_FAILURE, "pthread_create");
+        }
+    }
+    for (long int i = 0; i < options.threads; ++i) {
+        (void) pthread_join(loaders[i].thread, NULL);
+    }
+    elapsed = now() - measuring;
+
+    report(elapsed);
+
+    free_resources();
+    return EXIT_SUCCESS;
+}
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * NANOSECONDS + (uint64_t) ts.tv_nsec;
+}
+
+static void *run(void *arg)
+{
+    struct loader *loader = arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    for (;;) {
+        const uint64_t current = now();
+        int n;
+
+        if (current >= stopping) {
+            break;
+        }
+
+        /* open the connections due by now */
+        if (loader->opened < loader->count) {
+            long int due = loader->count;
+
+            if (current < measuring) {
+                due = (long int) ((double) loader->count * (current - started) / (measuring - started)) + 1;
+                if (due > loader->count) {
+                    due = loader->count;
+                }
+            }
+            for (; loader->opened < due; loader->opened++) {
+                start_game(loader, &loader->players[loader->opened]);
+            }
+        }
+
+        n = epoll_wait(loader->epfd, events, MAX_EVENTS, TICK_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            (void) fprintf(stderr, "%s: epoll_wait: %s\n", progname, strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            handle_event(loader, &loader->players[events[i].data.u32], events[i].events);
+        }
+    }
+
+    for (long int j = 0; j < loader->opened; ++j) {
+        if (loader->players[j].fd >= 0) {
+            (void) close(loader->players[j].fd);
+            loader->players[j].fd = -1;
+        }
+    }
+    return NULL;
+}
+
+static void start_game(struct loader *loader, struct player *player)
+{
+    struct epoll_event ev;
+
+    player->connected = 0;
+    player->round = 0;
+    player->hello = 0;
+    player->batched = 0;
+    player->framed = 0;
+    player->buffered = 0;
+    player->node = options.strategy == BOOK ? book_root(&book) : NULL;
+    if (player->solver != NULL) {
+        solver_init(player->solver);
+    }
+
+    player->fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (player->fd < 0) {
+        loader->errors++;
+        return;
+    }
+    if (connect(player->fd, (struct sockaddr *) &address, address_length) < 0 && errno != EINPROGRESS) {
+        loader->errors++;
+        (void) close(player->fd);
+        player->fd = -1;
+        return;
+    }
+
+    /* writable once connected */
+    ev.events = EPOLLOUT;
+    ev.data.u32 = (uint32_t) (player - loader->players);
+    if (epoll_ctl(loader->epfd, EPOLL_CTL_ADD, player->fd, &ev) < 0) {
+        loader->errors++;
+        (void) close(player->fd);
+        player->fd = -1;
+    }
+}
+
+static void end_game(struct loader *loader, struct player *player)
+{
+    (void) close(player->fd);
+    player->fd = -1;
+    if (now() < stopping) {
+        start_game(loader, player);
+    }
+}
+
+static void handle_event(struct loader *loader, struct player *player, uint32_t events)
+{
+    const int counting = now() >= measuring;
+    uint8_t answer;
+    ssize_t r;
+
+    if (player->fd < 0) {
+        return;
+    }
+
+    if (!player->connected) {
+        struct epoll_event ev;
+        socklen_t length = sizeof(int);
+        int error = 0;
+        int val = 1;
+
+        if (getsockopt(player->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            loader->errors++;
+            end_game(loader, player);
+            return;
+        }
+        (void) setsockopt(player->fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t) (player - loader->players);
+        if (epoll_ctl(loader->epfd, EPOLL_CTL_MOD, player->fd, &ev) < 0) {
+            loader->errors++;
+            end_game(loader, player);
+            return;
+        }
+        if (options.pipeline > 0 && !loader->classic) {
+            const uint16_t hello = BATCH_HELLO;
+
+            player->hello = 1;
+            player->sent = now();
+            r = send(player->fd, &hello, sizeof(hello), MSG_NOSIGNAL);
+        } else {
+            r = send_guess(loader, player) < 0 ? -1 : (ssize_t) sizeof(uint16_t);
+        }
+        if (r != sizeof(uint16_t)) {
+            loader->errors++;
+            end_game(loader, player);
+            return;
+        }
+        player->connected = 1;
+        return;
+    }
+
+    if (player->hello) {
+        handle_hello(loader, player);
+        return;
+    }
+    if (player->batched) {
+        handle_frame(loader, player, counting);
+        return;
+    }
+
+    r = recv(player->fd, &answer, 1, 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (r <= 0) {
+        loader->errors++;
+        end_game(loader, player);
+        return;
+    }
+
+    if (counting) {
+        hdr_record(&loader->latency, now() - player->sent);
+    }
+    if (apply_answer(loader, player, player->guess, answer, counting) < 0) {
+        end_game(loader, player);
+        return;
+    }
+
+    if (send_guess(loader, player) < 0) {
+        loader->errors++;
+        end_game(loader, player);
+    }
+}
+
+static void handle_hello(struct loader *loader, struct player *player)
+{
+    uint8_t answer;
+    ssize_t r;
+
+    r = recv(player->fd, &answer, 1, 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (r <= 0) {
+        loader->errors++;
+        end_game(loader, player);
+        return;
+    }
+    player->hello = 0;
+
+    if (answer == BATCH_ACK) {
+        player->batched = 1;
+        if (send_frame(loader, player) < 0) {
+            loader->errors++;
+            end_game(loader, player);
+        }
+        return;
+    }
+    if (answer & (1 << PARITY_ERR_BIT)) {
+        /* an older server, which ended the game on the wrong parity */
+        loader->classic = 1;
+    } else {
+        loader->errors++;
+    }
+    end_game(loader, player);
+}
+
+static void handle_frame(struct loader *loader, struct player *player, int counting)
+{
+    size_t expected;
+    ssize_t r;
+
+    r = recv(player->fd, player->in + player->buffered, sizeof(player->in) - player->buffered, 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (r <= 0) {
+        loader->errors++;
+        end_game(loader, player);
+        return;
+    }
+    player->buffered += (size_t) r;
+
+    /* only one frame is in flight, so nothing follows its answer */
+    expected = 1 + (size_t) player->in[0] * BATCH_ANSWER_BYTES;
+    if (player->in[0] > player->framed || player->buffered > expected) {
+        loader->errors++;
+        end_game(loader, player);
+        return;
+    }
+    if (player->buffered < expected) {
+        return;
+    }
+    player->buffered = 0;
+    if (counting) {
+        hdr_record(&loader->latency, now() - player->sent);
+    }
+
+    for (int i = 0; i < player->in[0]; ++i) {
+        const uint8_t seq = player->in[1 + i * BATCH_ANSWER_BYTES];
+        const uint8_t answer = player->in[2 + i * BATCH_ANSWER_BYTES];
+
+        if (seq != i) {
+            loader->errors++;
+            end_game(loader, player);
+            return;
+        }
+        if (apply_answer(loader, player, player->frame[i], answer, counting) < 0) {
+            end_game(loader, player);
+            return;
+        }
+    }
+    /* guesses are only left out after the end of the game */
+    if (player->in[0] < player->framed) {
+        loader->errors++;
+        end_game(loader, player);
+        return;
+    }
+
+    if (send_frame(loader, player) < 0) {
+        loader->errors++;
+        end_game(loader, player);
+    }
+}
+
+static int apply_answer(struct loader *loader, struct player *player, uint16_t guess, uint8_t answer,
+                        int counting)
+{
+    player->round++;
+    if (counting) {
+        loader->requests++;
+    }
+
+    if (answer & (1 << PARITY_ERR_BIT)) {
+        loader->errors++;
+        return -1;
+    }
+    if ((answer & (COLORS - 1)) == SLOTS || (answer & (1 << GAME_LOST_ERR_BIT))) {
+        if (counting) {
+            loader->games++;
+            if ((answer & (COLORS - 1)) == SLOTS) {
+                loader->won++;
+                loader->rounds += player->round;
+            } else {
+                loader->lost++;
+            }
+        }
+        return -1;
+    }
+
+    /* learn from the answer */
+    if (player->node != NULL) {
+        player->node = book_child(&book, player->node, answer);
+    }
+    if (player->solver != NULL) {
+        solver_update(player->solver, guess, answer);
+    }
+    return 0;
+}
+
+static uint16_t choose_guess(struct loader *loader, struct player *player)
+{
+    if (player->node != NULL) {
+        return player->node->guess & CODE_MASK;
+    }
+    if (player->solver != NULL && player->solver->remaining > 0) {
+        return consistent_code(player->solver, draw(loader) % player->solver->remaining);
+    }
+    return (uint16_t) (draw(loader) & CODE_MASK);
+}
+
+static uint16_t consistent_code(const struct solver *solver, uint64_t k)
+{
+    uint32_t w = 0;
+    uint64_t bits;
+
+    while (k >= (uint64_t) __builtin_popcountll(solver->consistent[w])) {
+        k -= __builtin_popcountll(solver->consistent[w]);
+        w++;
+    }
+    bits = solver->consistent[w];
+    for (; k > 0; k--) {
+        bits &= bits - 1;
+    }
+    return (uint16_t) (w * 64 + __builtin_ctzll(bits));
+}
+
+static int send_guess(struct loader *loader, struct player *player)
+{
+    uint16_t request;
+
+    player->guess = choose_guess(loader, player);
+    request = make_request(player->guess);
+    player->sent = now();
+    if (send(player->fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int send_frame(struct loader *loader, struct player *player)
+{
+    uint8_t out[BATCH_FRAME_BYTES(MAX_BATCH)];
+    const struct solver *solver = player->solver;
+    int count = 0;
+
+    if (player->node != NULL) {
+        /* the book only knows what follows the answer to its guess */
+        player->frame[count++] = choose_guess(loader, player);
+    } else if (solver != NULL && solver->remaining > 0 && solver->remaining <= (uint32_t) options.pipeline) {
+        /* one of them is the secret */
+        for (; count < (int) solver->remaining; ++count) {
+            player->frame[count] = consistent_code(solver, (uint64_t) count);
+        }
+    } else {
+        /* distinct codes, a few draws may repeat and are left out */
+        for (int draws = 0; draws < 2 * options.pipeline && count < options.pipeline; ++draws) {
+            const uint16_t guess = choose_guess(loader, player);
+            int i;
+
+            for (i = 0; i < count && player->frame[i] != guess; ++i) {
+                continue;
+            }
+            if (i == count) {
+                player->frame[count++] = guess;
+            }
+        }
+    }
+    player->framed = count;
+
+    out[0] = (uint8_t) count;
+    for (int i = 0; i < count; ++i) {
+        const uint16_t request = make_request(player->frame[i]);
+        uint8_t *guess = out + 1 + i * BATCH_GUESS_BYTES;
+
+        guess[0] = (uint8_t) i;
+        guess[1] = (uint8_t) (request & 0xff);
+        guess[2] = (uint8_t) (request >> 8);
+    }
+    player->sent = now();
+    if (send(player->fd, out, BATCH_FRAME_BYTES(count), MSG_NOSIGNAL) != (ssize_t) BATCH_FRAME_BYTES(count)) {
+        return -1;
+    }
+    return 0;
+}
+
+static uint16_t make_request(uint16_t guess)
+{
+    return guess | (uint16_t) (__builtin_parity(guess) << PARITY_BIT);
+}
+
+static uint64_t draw(struct loader *loader)
+{
+    uint64_t z = (loader->rng += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void report(uint64_t elapsed)
+{
+    struct hdr *latency;
+    uint64_t games = 0, won = 0, lost = 0, errors = 0, requests = 0, rounds = 0;
+    const double seconds = (double) elapsed / NANOSECONDS;
+
+    latency = malloc(sizeof(*latency));
+    if (latency == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    hdr_init(latency);
+
+    for (long int i = 0; i < options.threads; ++i) {
+        games += loaders[i].games;
+        won += loaders[i].won;
+        lost += loaders[i].lost;
+        errors += loaders[i].errors;
+        requests += loaders[i].requests;
+        rounds += loaders[i].rounds;
+        hdr_merge(latency, &loaders[i].latency);
+    }
+
+    (void) printf("connections: %ld threads: %ld ramp-up: %.1fs measured: %.2fs\n",
+        options.connections, options.threads, options.rampup, seconds);
+    (void) printf("games: %llu (%.1f/s) won: %llu lost: %llu errors: %llu rounds/win: %.2f\n",
+        (unsigned long long) games, games / seconds, (unsigned long long) won, (unsigned long long) lost,
+        (unsigned long long) errors, won > 0 ? (double) rounds / won : 0.0);
+    (void) printf("requests: %llu (%.1f/s)\n", (unsigned long long) requests, requests / seconds);
+    (void) printf("latency [us]: min %.1f mean %.1f p50 %.1f p99 %.1f p999 %.1f max %.1f\n",
+        latency->total > 0 ? latency->min / 1e3 : 0.0,
+        latency->total > 0 ? (double) latency->sum / latency->total / 1e3 : 0.0,
+        hdr_percentile(latency, 50.0) / 1e3, hdr_percentile(latency, 99.0) / 1e3,
+        hdr_percentile(latency, 99.9) / 1e3, latency->max / 1e3);
+
+    free(latency);
+}
+
+static void free_resources(void)
+{
+    if (loaders != NULL) {
+        for (long int i = 0; i < options.threads; ++i) {
+            if (loaders[i].players != NULL) {
+                for (long int j = 0; j < loaders[i].count; ++j) {
+                    free(loaders[i].players[j].solver);
+                }
+                free(loaders[i].players);
+            }
+            if (loaders[i].epfd >= 0) {
+                (void) close(loaders[i].epfd);
+            }
+        }
+        free(loaders);
+        loaders = NULL;
+    }
+    book_close(&book);
+}
+
+static void bail_out(int exitcode, const char *fmt, ...)
+{
+    va_list ap;
+
+    (void) fprintf(stderr, "%s: ", progname);
+    if (fmt != NULL) {
+        va_start(ap, fmt);
+        (void) vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    if (errno != 0) {
+        (void) fprintf(stderr, ": %s", strerror(errno));
+    }
+    (void) fprintf(stderr, "\n");
+
+    free_resources();
+    exit(exitcode);
+}
+
+static void parse_args(int argc, char **argv, struct opts *opts)
+{
+    const char *usage = "Usage: %s [-c connections] [-t threads] [-d seconds] [-r ramp-up-seconds] "
+                        "[-s random|consistent|book] [-b book] [-p guesses-per-frame] <server-hostname> <server-port>";
+    char *endptr;
+    int c;
+
+    if (argc > 0) {
+        progname = argv[0];
+    }
+
+    opts->connections = 100;
+    opts->threads = 1;
+    opts->duration = 10.0;
+    opts->rampup = 1.0;
+    opts->strategy = CONSISTENT;
+    opts->bookpath = NULL;
+    opts->pipeline = 0;
+
+    while ((c = getopt(argc, argv, "c:t:d:r:s:b:p:")) != -1) {
+        errno = 0;
+        switch (c) {
+            case 'c':
+                opts->connections = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || *endptr != '\0' || opts->connections < 1 || opts->connections > 1000000) {
+                    bail_out(EXIT_FAILURE, "<connections> has to be between 1 and 1000000");
+                }
+                break;
+            case 't':
+                opts->threads = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || *endptr != '\0' || opts->threads < 1 || opts->threads > 1024) {
+                    bail_out(EXIT_FAILURE, "<threads> has to be between 1 and 1024");
+                }
+                break;
+            case 'd':
+                opts->duration = strtod(optarg, &endptr);
+                if (endptr == optarg || *endptr != '\0' || !(opts->duration > 0)) {
+                    bail_out(EXIT_FAILURE, "<seconds> has to be positive");
+                }
+                break;
+            case 'r':
+                opts->rampup = strtod(optarg, &endptr);
+                if (endptr == optarg || *endptr != '\0' || !(opts->rampup >= 0)) {
+                    bail_out(EXIT_FAILURE, "<ramp-up-seconds> must not be negative");
+                }
+                break;
+            case 's':
+                if (strcmp(optarg, "random") == 0) {
+                    opts->strategy = RANDOM;
+                } else if (strcmp(optarg, "consistent") == 0) {
+                    opts->strategy = CONSISTENT;
+                } else if (strcmp(optarg, "book") == 0) {
+                    opts->strategy = BOOK;
+                } else {
+                    bail_out(EXIT_FAILURE, "Unknown strategy %s", optarg);
+                }
+                break;
+            case 'b':
+                opts->bookpath = optarg;
+                break;
+            case 'p':
+                opts->pipeline = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || *endptr != '\0' || opts->pipeline < 1 || opts->pipeline > MAX_BATCH) {
+                    bail_out(EXIT_FAILURE, "<guesses-per-frame> has to be between 1 and %d", MAX_BATCH);
+                }
+                break;
+            default:
+                bail_out(EXIT_FAILURE, usage, progname);
+        }
+    }
+    errno = 0;
+    if (argc - optind != 2) {
+        bail_out(EXIT_FAILURE, usage, progname);
+    }
+    if (opts->strategy == BOOK && opts->bookpath == NULL) {
+        bail_out(EXIT_FAILURE, "The book strategy needs -b <book>");
+    }
+    if (opts->threads > opts->connections) {
+        opts->threads = opts->connections;
+    }
+
+    opts->hostname = argv[optind];
+    opts->portno = strtol(argv[optind + 1], &endptr, 10);
+    if (endptr == argv[optind + 1] || *endptr != '\0' || opts->portno < 1 || opts->portno > 65535) {
+        bail_out(EXIT_FAILURE, "Use a valid TCP/IP port range (1-65535)");
+    }
+}
@@ -0,0 +1,413 @@
+/**
+ * name     mm-sim
+ * @file    mm-sim.c
+ *
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Plays the client strategy against every secret without a network
+ * @detail  Games are deterministic, so the games of all CODES secrets form one
+ *          decision tree: the secrets which got the same answers so far share the
+ *          client state and its next guess. The tree is played one round at a
+ *          time; the guesses of a round are chosen in parallel by the threads, the
+ *          answers are scored with the kernels of the server's score tables. With
+ *          an opening book the client plays its first rounds by lookup, like
+ *          client -b. Prints how many rounds the secrets needed and the time spent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "mastermind-common.h"
+#include "score.h"
+#include "solver.h"
+#include "book.h"
+
+/* === Type Definitions === */
+
+/* A client state shared by the secrets which got the same answers */
+struct task {
+    struct solver state;                /* the game before the guess */
+    const struct book_node *node;       /* book node of the guess, NULL when off the book */
+    uint32_t first;                     /* secrets of the task in its round */
+    uint32_t count;
+    int guess;
+};
+
+/* The tasks of one round */
+struct round {
+    struct task *tasks;
+    uint32_t ntasks;
+    uint16_t *secrets;                  /* grouped by task */
+    uint32_t nsecrets;
+    uint32_t next;                      /* next task to choose a guess for, taken atomically */
+};
+
+/* === Global Variables === */
+
+/* Name of the program */
+static const char *progname = "mm-sim"; /* default name */
+
+/* Opening book, book.nodes is NULL without one */
+static struct book book;
+
+/* Secrets won after a number of rounds, and lost ones */
+static uint64_t won[MAX_TRIES + 1];
+static uint64_t lost = 0;
+
+/* A secret which needed the most rounds */
+static uint16_t worst_secret = 0;
+static int worst = 0;
+
+/* Guesses chosen by the solver and by the book */
+static uint64_t solver_moves = 0;
+static uint64_t book_moves = 0;
+
+/* Both rounds in play */
+static struct round rounds[2];
+
+/* === Prototypes === */
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief free allocated resources
+ */
+static void free_resources(void);
+
+/**
+ * @brief Chooses the guesses of all tasks of a round
+ * @param round the round
+ * @param threads number of threads, the calling one included
+ */
+static void choose_guesses(struct round *round, long threads);
+
+/**
+ * @brief Entry point of a thread choosing guesses
+ * @param arg the round
+ * @return NULL
+ */
+static void *choose_main(void *arg);
+
+/**
+ * @brief Answers the guesses of a round and groups the secrets by answer
+ * @param round the round
+ * @param number number of the round, starting at 1
+ * @param next the tasks of the next round
+ */
+static void play_round(const struct round *round, int number, struct round *next);
+
+/**
+ * @brief Current time
+ * @param clock the clock
+ * @return seconds
+ */
+static double seconds(clockid_t clock);
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS if every secret was found, EXIT_FAILURE otherwise
+ */
+int main(int argc, char *argv[])
+{
+    static const char letters[] = "bdgorsvw";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *book_path = NULL;
+    double wall, cpu;
+    uint64_t sum = 0;
+    char *ptr;
+    int number;
+    int c;
+
+    if (argc > 0) progname = argv[0];
+
+    //Handle args
+    while ((c = getopt(argc, argv, "b:t:")) != -1) {
+        switch (c) {
+            case 'b':
+                book_path = optarg;
+                break;
+            case 't':
+                threads = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || threads < 1 || threads > 1024) {
+                    bail_out(EXIT_FAILURE, "<threads> has to be between 1 and 1024");
+                }
+                break;
+            default:
+                bail_out(EXIT_FAILURE, "Usage: %s [-b book] [-t threads]", progname);
+        }
+    }
+    if (argc != optind) {
+        bail_out(EXIT_FAILURE, "Usage: %s [-b book] [-t threads]", progname);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    if (book_path != NULL && book_open(&book, book_path) < 0) {
+        bail_out(EXIT_FAILURE, "Can not use book %s", book_path);
+    }
+
+    //Every secret starts in the same state
+    for (int i = 0; i < 2; ++i) {
+        rounds[i].secrets = malloc(CODES * sizeof(*rounds[i].secrets));
+        if (rounds[i].secrets == NULL) {
+            bail_out(EXIT_FAILURE, "malloc");
+        }
+    }
+    rounds[0].tasks = malloc(sizeof(*rounds[0].tasks));
+    if (rounds[0].tasks == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    rounds[0].ntasks = 1;
+    rounds[0].nsecrets = CODES;
+    solver_init(&rounds[0].tasks[0].state);
+    rounds[0].tasks[0].node = book.nodes != NULL ? book_root(&book) : NULL;
+    rounds[0].tasks[0].first = 0;
+    rounds[0].tasks[0].count = CODES;
+    for (uint32_t secret = 0; secret < CODES; ++secret) {
+        rounds[0].secrets[secret] = (uint16_t) secret;
+    }
+
+    wall = seconds(CLOCK_MONOTONIC);
+    cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+
+    //Play all games round by round
+    for (number = 1; rounds[(number - 1) % 2].ntasks > 0; ++number) {
+        struct round *round = &rounds[(number - 1) % 2];
+
+        choose_guesses(round, threads);
+        play_round(round, number, &rounds[number % 2]);
+        DEBUG("round %d: %u states\n", number, round->ntasks);
+    }
+
+    wall = seconds(CLOCK_MONOTONIC) - wall;
+    cpu = seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+    //Report
+    (void) printf("secrets: %d threads: %ld book: ", CODES, threads);
+    if (book.nodes != NULL) {
+        (void) printf("%u rounds\n", book.header->depth);
+    } else {
+        (void) printf("none\n");
+    }
+    (void) printf("rounds to win:");
+    for (int r = 1; r <= MAX_TRIES; ++r) {
+        if (won[r] != 0) {
+            (void) printf(" %d:%llu", r, (unsigned long long) won[r]);
+            sum += won[r] * r;
+        }
+    }
+    (void) printf("\nwon: %llu lost: %llu mean: %.4f worst: %d (",
+        (unsigned long long) (CODES - lost), (unsigned long long) lost,
+        lost < CODES ? (double) sum / (CODES - lost) : 0.0, worst);
+    for (int j = 0; j < SLOTS; ++j) {
+        (void) putchar(letters[(worst_secret >> (j * SHIFT_WIDTH)) & (COLORS - 1)]);
+    }
+    (void) printf(")\nguesses: solver %llu book %llu\n",
+        (unsigned long long) solver_moves, (unsigned long long) book_moves);
+    (void) printf("time: %.3f s wall %.3f s cpu, per game %.1f us wall %.1f us cpu",
+        wall, cpu, wall * 1e6 / CODES, cpu * 1e6 / CODES);
+    if (solver_moves > 0) {
+        (void) printf(", per solver guess %.3f ms cpu", cpu * 1e3 / solver_moves);
+    }
+    (void) printf("\n");
+
+    free_resources();
+    return lost == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void choose_guesses(struct round *round, long threads)
+{
+    pthread_t *helpers = malloc(threads * sizeof(*helpers));
+    long started;
+
+    if (helpers == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    round->next = 0;
+    for (started = 0; started < threads - 1; ++started) {
+        errno = pthread_create(&helpers[started], NULL, choose_main, round);
+        if (errno != 0) {
+            break;
+        }
+    }
+    (void) choose_main(round);
+    for (long i = 0; i < started; ++i) {
+        (void) pthread_join(helpers[i], NULL);
+    }
+    free(helpers);
+
+    for (uint32_t i = 0; i < round->ntasks; ++i) {
+        if (round->tasks[i].node != NULL) {
+            book_moves++;
+        } else {
+            solver_moves++;
+        }
+    }
+}
+
+static void *choose_main(void *arg)
+{
+    struct round *round = arg;
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(&round->next, 1, __ATOMIC_RELAXED);
+        struct task *task;
+
+        if (i >= round->ntasks) {
+            return NULL;
+        }
+        task = &round->tasks[i];
+        if (task->node != NULL) {
+            task->guess = task->node->guess & CODE_MASK;
+        } else {
+            task->guess = solver_next(&task->state);
+        }
+    }
+}
+
+static void play_round(const struct round *round, int number, struct round *next)
+{
+    uint8_t *answers;
+    uint32_t ntasks = 0;
+
+    /* the answers of the server, and the states they lead to */
+    answers = malloc(round->nsecrets);
+    if (answers == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    for (uint32_t i = 0; i < round->ntasks; ++i) {
+        const struct task *task = &round->tasks[i];
+        uint64_t seen = 0;
+
+        if (task->guess < 0) {
+            bail_out(EXIT_FAILURE, "No sequence fits the answers in round %d", number);
+        }
+        for (uint32_t k = task->first; k < task->first + task->count; ++k) {
+            answers[k] = score_compute((uint16_t) task->guess, round->secrets[k]);
+            if ((answers[k] & (COLORS - 1)) != SLOTS) {
+                seen |= 1ull << answers[k];
+            }
+        }
+        if (number < MAX_TRIES) {
+            ntasks += __builtin_popcountll(seen);
+        }
+    }
+
+    free(next->tasks);
+    next->tasks = ntasks > 0 ? malloc(ntasks * sizeof(*next->tasks)) : NULL;
+    if (ntasks > 0 && next->tasks == NULL) {
+        free(answers);
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    next->ntasks = 0;
+    next->nsecrets = 0;
+
+    for (uint32_t i = 0; i < round->ntasks; ++i) {
+        const struct task *task = &round->tasks[i];
+        uint32_t counts[SOLVER_ANSWERS] = { 0 };
+        uint32_t child[SOLVER_ANSWERS];
+
+        for (uint32_t k = task->first; k < task->first + task->count; ++k) {
+            const uint16_t secret = round->secrets[k];
+
+            if ((answers[k] & (COLORS - 1)) == SLOTS) {
+                won[number]++;
+                if (number > worst) {
+                    worst = number;
+                    worst_secret = secret;
+                }
+            } else if (number == MAX_TRIES) {
+                lost++;
+            } else {
+                counts[answers[k]]++;
+            }
+        }
+
+        /* one task per answer, its secrets are kept together */
+        for (int answer = 0; answer < SOLVER_ANSWERS; ++answer) {
+            struct task *t;
+
+            if (counts[answer] == 0) {
+                continue;
+            }
+            child[answer] = next->ntasks;
+            t = &next->tasks[next->ntasks++];
+            t->state = task->state;
+            solver_update(&t->state, (uint16_t) task->guess, (uint8_t) answer);
+            t->node = task->node != NULL ? book_child(&book, task->node, (uint8_t) answer) : NULL;
+            t->first = next->nsecrets;
+            t->count = 0;
+            next->nsecrets += counts[answer];
+        }
+        for (uint32_t k = task->first; k < task->first + task->count; ++k) {
+            struct task *t;
+
+            if ((answers[k] & (COLORS - 1)) == SLOTS || number == MAX_TRIES) {
+                continue;
+            }
+            t = &next->tasks[child[answers[k]]];
+            next->secrets[t->first + t->count++] = round->secrets[k];
+
+            /* the solver scores on its own, it must agree with the server */
+            if (!(t->state.consistent[round->secrets[k] / 64] >> (round->secrets[k] % 64) & 1)) {
+                free(answers);
+                bail_out(EXIT_FAILURE, "The solver dropped secret 0x%x in round %d", round->secrets[k], number);
+            }
+        }
+    }
+
+    free(answers);
+}
+
+static double seconds(clockid_t clock)
+{
+    struct timespec ts;
+
+    (void) clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void free_resources(void)
+{
+    for (int i = 0; i < 2; ++i) {
+        free(rounds[i].tasks);
+        free(rounds[i].secrets);
+        rounds[i].tasks = NULL;
+        rounds[i].secrets = NULL;
+    }
+    if (book.nodes != NULL) {
+        book_close(&book);
+    }
+}
+
+static void bail_out(int exitcode, const char *fmt, ...)
+{
+    va_list ap;
+
+    (void) fprintf(stderr, "%s: ", progname);
+    if (fmt != NULL) {
+        va_start(ap, fmt);
+        (void) vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    if (errno != 0) {
+        (void) fprintf(stderr, ": %s", strerror(errno));
+    }
+    (void) fprintf(stderr, "\n");
+
+    free_resources();
+    exit(exitcode);
+}
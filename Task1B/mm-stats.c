@@ -0,0 +1,210 @@
+/**
+ * name     mm-stats
+ * @file    mm-stats.c
+ *
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Shows the counters of a running mastermind server
+ * @detail  Maps the stats file of a server started with -m, sums up its workers
+ *          and prints the totals, once or every few seconds
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include "mastermind-common.h"
+#include "metrics.h"
+#include "hdr.h"
+
+/* === Type Definitions === */
+
+/* Sum of all workers */
+struct totals {
+    uint64_t active;
+    uint64_t started;
+    uint64_t won;
+    uint64_t lost;
+    uint64_t parity_errors;
+    uint64_t idle_timeouts;
+    uint64_t game_timeouts;
+    uint64_t requests;
+    uint64_t rounds[MAX_TRIES + 1];
+    struct hdr service;
+};
+
+/* === Global Variables === */
+
+/* Name of the program */
+static const char *progname = "mm-stats"; /* default name */
+
+static struct metrics_file file;
+
+/* === Prototypes === */
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief Sums up the counters of all workers
+ * @param totals the sums
+ */
+static void collect(struct totals *totals);
+
+/**
+ * @brief Prints the sums
+ * @param totals the sums
+ * @param last the sums of the last report, NULL for the first one
+ * @param seconds time since the last report
+ */
+static void show(const struct totals *totals, const struct totals *last, double seconds);
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error
+ */
+int main(int argc, char *argv[])
+{
+    struct totals *totals;
+    struct totals *last;
+    long interval = 0;
+    long count = -1;
+    char *ptr;
+    int c;
+
+    if (argc > 0) progname = argv[0];
+
+    while ((c = getopt(argc, argv, "i:n:")) != -1) {
+        switch (c) {
+            case 'i':
+                interval = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || interval < 1) {
+                    bail_out(EXIT_FAILURE, "<seconds> has to be positive");
+                }
+                break;
+            case 'n':
+                count = strtol(optarg, &ptr, 10);
+                if (ptr == optarg || *ptr != '\0' || count < 1) {
+                    bail_out(EXIT_FAILURE, "<count> has to be positive");
+                }
+                break;
+            default:
+                bail_out(EXIT_FAILURE, "Usage: %s [-i seconds [-n count]] <stats-file>", progname);
+        }
+    }
+    if (argc - optind != 1) {
+        bail_out(EXIT_FAILURE, "Usage: %s [-i seconds [-n count]] <stats-file>", progname);
+    }
+
+    if (metrics_open(&file, argv[optind]) < 0) {
+        bail_out(EXIT_FAILURE, "Can not read stats file %s", argv[optind]);
+    }
+
+    totals = malloc(sizeof(*totals));
+    last = malloc(sizeof(*last));
+    if (totals == NULL || last == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+
+    collect(totals);
+    show(totals, NULL, 0);
+
+    //Rates since the last report
+    for (long i = 1; interval > 0 && i != count; i++) {
+        struct totals *swap = last;
+
+        last = totals;
+        totals = swap;
+        (void) sleep((unsigned int) interval);
+        collect(totals);
+        show(totals, last, (double) interval);
+    }
+
+    free(totals);
+    free(last);
+    metrics_close(&file);
+    return EXIT_SUCCESS;
+}
+
+static void collect(struct totals *totals)
+{
+    (void) memset(totals, 0, sizeof(*totals));
+    hdr_init(&totals->service);
+
+    for (uint32_t i = 0; i < file.header->workers; ++i) {
+        const struct metrics *worker = &file.workers[i];
+
+        totals->active += metrics_read(&worker->active);
+        totals->started += metrics_read(&worker->started);
+        totals->won += metrics_read(&worker->won);
+        totals->lost += metrics_read(&worker->lost);
+        totals->parity_errors += metrics_read(&worker->parity_errors);
+        totals->idle_timeouts += metrics_read(&worker->idle_timeouts);
+        totals->game_timeouts += metrics_read(&worker->game_timeouts);
+        totals->requests += metrics_read(&worker->requests);
+        for (int r = 0; r <= MAX_TRIES; ++r) {
+            totals->rounds[r] += metrics_read(&worker->rounds[r]);
+        }
+        hdr_merge(&totals->service, &worker->service);
+    }
+}
+
+static void show(const struct totals *totals, const struct totals *last, double seconds)
+{
+    const struct hdr *service = &totals->service;
+    char stamp[32];
+    time_t t = time(NULL);
+
+    (void) strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&t));
+    (void) printf("%s pid %lld workers %u\n", stamp, (long long) file.header->pid, file.header->workers);
+    (void) printf("connections: %llu\n", (unsigned long long) totals->active);
+    (void) printf("games: started %llu won %llu lost %llu parity_errors %llu\n",
+        (unsigned long long) totals->started, (unsigned long long) totals->won,
+        (unsigned long long) totals->lost, (unsigned long long) totals->parity_errors);
+    (void) printf("timeouts: idle %llu game %llu\n",
+        (unsigned long long) totals->idle_timeouts, (unsigned long long) totals->game_timeouts);
+    (void) printf("requests: %llu", (unsigned long long) totals->requests);
+    if (last != NULL) {
+        (void) printf(" (%.1f/s, %.1f games/s)", (totals->requests - last->requests) / seconds,
+            (totals->started - last->started) / seconds);
+    }
+    (void) printf("\nrounds to win:");
+    for (int r = 1; r <= MAX_TRIES; ++r) {
+        if (totals->rounds[r] != 0) {
+            (void) printf(" %d:%llu", r, (unsigned long long) totals->rounds[r]);
+        }
+    }
+    (void) printf("\nservice [us]: mean %.2f p50 %.2f p99 %.2f p999 %.2f max %.2f\n\n",
+        service->total > 0 ? (double) service->sum / service->total / 1e3 : 0.0,
+        hdr_percentile(service, 50.0) / 1e3, hdr_percentile(service, 99.0) / 1e3,
+        hdr_percentile(service, 99.9) / 1e3, service->max / 1e3);
+    (void) fflush(stdout);
+}
+
+static void bail_out(int exitcode, const char *fmt, ...)
+{
+    va_list ap;
+
+    (void) fprintf(stderr, "%s: ", progname);
+    if (fmt != NULL) {
+        va_start(ap, fmt);
+        (void) vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    if (errno != 0) {
+        (void) fprintf(stderr, ": %s", strerror(errno));
+    }
+    (void) fprintf(stderr, "\n");
+
+    metrics_close(&file);
+    exit(exitcode);
+}
@@ -0,0 +1,176 @@
+/**
+ * @file    score.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the score module
+ **/
+
+#include "score.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* === Kernels === */
+
+/*
+ * SCORE_KERNELS(slots, colors, shift) defines pack_<slots>x<colors>, compute_<slots>x<colors> and
+ * parity_<slots>x<colors>. With the geometry known at compile time the loops are unrolled and the color
+ * counts live in registers. The typedef fails to compile for geometries that do not fit a request.
+ */
+#define SCORE_KERNELS(slots, colors, shift) \
+    typedef char fits_##slots##x##colors[((slots) * (shift) <= PARITY_BIT \
+        && (slots) <= SCORE_MAX_SLOTS && (colors) <= (1 << (shift))) ? 1 : -1]; \
+    \
+    static uint16_t pack_##slots##x##colors(const uint8_t *c) \
+    { \
+        uint16_t code = 0; \
+        \
+        for (int j = 0; j < (slots); ++j) { \
+            code |= (uint16_t) (c[j] << (j * (shift))); \
+        } \
+        return code; \
+    } \
+    \
+    static uint8_t compute_##slots##x##colors(uint16_t guess, uint16_t secret) \
+    { \
+        uint8_t colors_left[1 << (shift)]; \
+        int red = 0, white = 0; \
+        \
+        (void) memset(colors_left, 0, sizeof(colors_left)); \
+        /* mark red */ \
+        for (int j = 0; j < (slots); ++j) { \
+            int g = (guess >> (j * (shift))) & ((1 << (shift)) - 1); \
+            int s = (secret >> (j * (shift))) & ((1 << (shift)) - 1); \
+            \
+            if (g == s) { \
+                red++; \
+            } else { \
+                colors_left[s]++; \
+            } \
+        } \
+        /* mark white among the colors not marked red */ \
+        for (int j = 0; j < (slots); ++j) { \
+            int g = (guess >> (j * (shift))) & ((1 << (shift)) - 1); \
+            int s = (secret >> (j * (shift))) & ((1 << (shift)) - 1); \
+            \
+            if (g != s && colors_left[g] > 0) { \
+                white++; \
+                colors_left[g]--; \
+            } \
+        } \
+        return (uint8_t) (red | (white << SHIFT_WIDTH)); \
+    } \
+    \
+    static uint16_t parity_##slots##x##colors(uint16_t code) \
+    { \
+        return (uint16_t) (__builtin_parity(code & ((1u << ((slots) * (shift))) - 1)) << PARITY_BIT); \
+    }
+
+#define SCORE_GEOMETRY(slots, colors, shift) \
+    { #slots "x" #colors, (slots), (colors), (shift), \
+      pack_##slots##x##colors, compute_##slots##x##colors, parity_##slots##x##colors },
+
+/* Supported geometries: slots, colors, bits per color */
+#define SCORE_GEOMETRIES(X) \
+    X(4, 6, 3) \
+    X(4, 8, 3) \
+    X(5, 6, 3) \
+    X(5, 8, 3)
+
+SCORE_GEOMETRIES(SCORE_KERNELS)
+
+const struct score_geometry score_geometries[] = {
+    SCORE_GEOMETRIES(SCORE_GEOMETRY)
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+/* the default geometry is called directly, so its kernels are inlined */
+typedef char default_is_5x8[(SLOTS == 5 && COLORS == 8 && SHIFT_WIDTH == 3) ? 1 : -1];
+
+/* === Tables === */
+
+/* Tables in use, indexed by the code of the secret, chained by geometry */
+static struct score_table *tables[CODES];
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const struct score_geometry *score_geometry(int slots, int colors)
+{
+    for (const struct score_geometry *geometry = score_geometries; geometry->name != NULL; ++geometry) {
+        if (geometry->slots == slots && geometry->colors == colors) {
+            return geometry;
+        }
+    }
+    return NULL;
+}
+
+uint16_t score_pack(const uint8_t *colors)
+{
+    return pack_5x8(colors);
+}
+
+uint8_t score_compute(uint16_t guess, uint16_t secret)
+{
+    return compute_5x8(guess, secret);
+}
+
+uint16_t score_parity(uint16_t code)
+{
+    return parity_5x8(code);
+}
+
+const struct score_table *score_table_get(const struct score_geometry *geometry, uint16_t secret)
+{
+    struct score_table *table;
+
+    secret &= CODE_MASK;
+
+    (void) pthread_mutex_lock(&tables_lock);
+    for (table = tables[secret]; table != NULL && table->geometry != geometry; table = table->next) {
+        continue;
+    }
+    if (table == NULL) {
+        table = malloc(sizeof(*table));
+        if (table != NULL) {
+            table->geometry = geometry;
+            table->secret = secret;
+            table->references = 0;
+            /* the answer to a request with a wrong parity carries the error bit */
+            for (uint32_t code = 0; code < CODES; ++code) {
+                uint8_t answer = geometry->compute((uint16_t) code, secret);
+                uint16_t request = (uint16_t) code | geometry->parity((uint16_t) code);
+
+                table->answers[request] = answer;
+                table->answers[request ^ (1 << PARITY_BIT)] = answer | (1 << PARITY_ERR_BIT);
+            }
+            table->next = tables[secret];
+            tables[secret] = table;
+        }
+    }
+    if (table != NULL) {
+        table->references++;
+    }
+    (void) pthread_mutex_unlock(&tables_lock);
+
+    return table;
+}
+
+void score_table_put(const struct score_table *table)
+{
+    struct score_table **link;
+
+    if (table == NULL) {
+        return;
+    }
+
+    (void) pthread_mutex_lock(&tables_lock);
+    for (link = &tables[table->secret]; *link != table; link = &(*link)->next) {
+        continue;
+    }
+    if (--(*link)->references == 0) {
+        struct score_table *entry = *link;
+
+        *link = entry->next;
+        free(entry);
+    }
+    (void) pthread_mutex_unlock(&tables_lock);
+}
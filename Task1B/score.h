@@ -0,0 +1,102 @@
+/**
+ * @file    score.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Scoring of mastermind guesses
+ * @details A sequence of colors is stored as a code: color i in bits i * shift to i * shift + shift - 1, like
+ * in a request. The board geometry (slots, colors and bits per color) is chosen at run time from
+ * score_geometries, every entry has its own kernels generated with the geometry as compile time constants.
+ * The default geometry SLOTS x COLORS is also reachable without the dispatch table, see score_pack().
+ *
+ * For a fixed secret the answers to all requests, both parities of every code, are computed once and kept in a
+ * score table, so answering a request is a single table load. Tables are shared: every holder of the same
+ * secret and geometry gets the same table, which is freed when the last reference is dropped.
+ **/
+
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <stdint.h>
+#include "mastermind-common.h"
+
+#define SCORE_MAX_SLOTS ((1 << SHIFT_WIDTH) - 1)   /**< most slots, red and white have SHIFT_WIDTH bits */
+#define SCORE_REQUESTS (1 << (PARITY_BIT + 1))      /**< number of different requests */
+
+/**
+ * @brief Kernels of one board geometry
+ * @details codes of every geometry fit below PARITY_BIT, unused bits of a request are ignored
+ */
+struct score_geometry {
+    const char *name;           /**< "<slots>x<colors>" */
+    int slots;
+    int colors;
+    int shift;                  /**< bits of a color in a code */
+    uint16_t (*pack)(const uint8_t *colors);                /**< see score_pack() */
+    uint8_t (*compute)(uint16_t guess, uint16_t secret);    /**< see score_compute() */
+    uint16_t (*parity)(uint16_t code);                      /**< see score_parity() */
+};
+
+/**
+ * @brief Answers to all requests for one secret
+ */
+struct score_table {
+    const struct score_geometry *geometry;
+    uint16_t secret;            /**< code of the secret */
+    unsigned int references;    /**< holders of the table, see score_table_get() */
+    struct score_table *next;   /**< table of the same secret in another geometry */
+    uint8_t answers[SCORE_REQUESTS];    /**< red | white << SHIFT_WIDTH of every request, or'ed with
+                                             1 << PARITY_ERR_BIT if its parity is wrong */
+};
+
+/**
+ * @brief All supported geometries, terminated by an entry with name NULL
+ */
+extern const struct score_geometry score_geometries[];
+
+/**
+ * @brief Looks up a geometry
+ * @param slots colors in a sequence
+ * @param colors number of different colors
+ * @return the geometry, NULL if it is not supported
+ */
+const struct score_geometry *score_geometry(int slots, int colors);
+
+/**
+ * @brief Packs a sequence of colors into a code of the default geometry
+ * @param colors SLOTS colors
+ * @return the code
+ */
+uint16_t score_pack(const uint8_t *colors);
+
+/**
+ * @brief Counts red and white pins of a guess in the default geometry
+ * @param guess code of the guess
+ * @param secret code of the secret
+ * @return red | white << SHIFT_WIDTH
+ */
+uint8_t score_compute(uint16_t guess, uint16_t secret);
+
+/**
+ * @brief Parity of a code of the default geometry
+ * @param code the code
+ * @return the parity bit at PARITY_BIT
+ */
+uint16_t score_parity(uint16_t code);
+
+/**
+ * @brief Gets the score table of a secret
+ * @details builds the table if nobody holds it yet, thread safe
+ * @param geometry geometry of the game
+ * @param secret code of the secret
+ * @return the table, NULL if out of memory
+ */
+const struct score_table *score_table_get(const struct score_geometry *geometry, uint16_t secret);
+
+/**
+ * @brief Drops a reference to a score table
+ * @details thread safe
+ * @param table the table from score_table_get()
+ */
+void score_table_put(const struct score_table *table);
+
+#endif // SCORE_H
@@ -24,9 +24,26 @@
  * @Author  Yannick Schwarenthorer, 1229026
  * @date    11. April 2016
  * @brief   Server for mastermind
- * @detail  This server acts as an opponent in mastermind
+ * @detail  This server acts as an opponent in mastermind. It hosts any number of
+ *          concurrent games in non-blocking epoll event loops, every connection
+ *          plays one game against the secret given on the command line, on a board
+ *          of 5 slots and 8 colors or the geometry given with -g. With -e the
+ *          server is an evil host without a secret, which answers every guess
+ *          so that as many codes as possible stay consistent, see evil.h. With -u
+ *          the loops use io_uring instead, see uring.h. With -w each worker
+ *          thread runs its own loop on its own SO_REUSEPORT listener, so the
+ *          workers share no state but the secret. A game takes a 44 byte record
+ *          from a slab, its buffers are only attached while it has unanswered
+ *          bytes or unsent answers. Games idle for longer than -i seconds or
+ *          running for longer than -t seconds are closed by a timer wheel,
+ *          see wheel.h. Clients may switch to
+ *          the batch protocol described in mastermind-common.h. Every worker
+ *          keeps its counters in a stats file given with -m, see metrics.h; games
+ *          are only logged in debug builds.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,64 +52,153 @@
 #include <stdarg.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <errno.h>
 #include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "mastermind-common.h"
+#include "score.h"
+#include "metrics.h"
+#include "uring.h"
+#include "slab.h"
+#include "wheel.h"
+#include "evil.h"
 
 
 /* === Constants === */
 
-#define MAX_TRIES (35)
-#define SLOTS (5)
-#define COLORS (8)
-
 #define READ_BYTES (2)
 #define WRITE_BYTES (1)
-#define BUFFER_BYTES (2)
-#define SHIFT_WIDTH (3)
-#define PARITY_ERR_BIT (6)
-#define GAME_LOST_ERR_BIT (7)
 
-#define EXIT_PARITY_ERROR (2)
-#define EXIT_GAME_LOST (3)
-#define EXIT_MULTIPLE_ERRORS (4)
+#define BACKLOG (SOMAXCONN)
+#define MAX_EVENTS (256)        /* events handled per epoll_wait() */
+#define CHUNK_BYTES (256)       /* bytes read from a connection at once */
+#define IN_BYTES (BATCH_FRAME_BYTES(MAX_BATCH))                 /* longest request */
+#define OUT_BYTES (1 + MAX_TRIES * (BATCH_ANSWER_BYTES + 1))    /* acknowledge and answers of a whole game */
+#define INITIAL_GAMES (1024)    /* initial size of the game table */
+#define GAME_SHIFT (12)         /* log2 of the game records per slab chunk */
+#define IO_SHIFT (8)            /* log2 of the game buffers per slab chunk */
+#define SET_SHIFT (4)           /* log2 of the candidate sets per slab chunk */
+#define SOCKET_BYTES (4096)     /* kernel buffers of a connection, answers and requests are tiny */
+
+/* Flags of a game */
+#define GAME_OVER (1 << 0)      /* the last answer is queued, close after sending it */
+#define GAME_BATCH (1 << 1)     /* the client switched to the batch protocol */
+#define GAME_OUTPUT (1 << 2)    /* waiting for EPOLLOUT; with io_uring, a send is in flight */
+#define MAX_WORKERS (256)
+#define URING_ENTRIES (1024)    /* submission queue entries of a ring */
+#define URING_BUFFERS (1024)    /* receive buffers of CHUNK_BYTES per ring */
+#define TICK_NS (100000000)     /* resolution of the timeouts */
+#define IDLE_SECONDS (60)       /* default time to wait for a request */
+#define GAME_SECONDS (600)      /* default time a game may take */
+#define MAX_SECONDS (86400)
+
+/* user_data of an io_uring request: operation, low 24 bits of the game id and file descriptor */
+#define RING_DATA(op, id, fd) (((uint64_t) (op) << 56) | ((uint64_t) ((id) & 0xffffff) << 32) | (uint32_t) (fd))
+#define RING_OP(data) ((int) ((data) >> 56))
+#define RING_ID(data) ((uint32_t) ((data) >> 32) & 0xffffff)
+#define RING_FD(data) ((uint32_t) (data))
 
-#define BACKLOG (5)
 
+/* === Type Definitions === */
 
-/* === Macros === */
+struct opts {
+    long int portno;
+    long int workers;
+    int uring;                          /* use io_uring instead of epoll */
+    long int idle_seconds;              /* 0 for no idle timeout */
+    long int game_seconds;              /* 0 for no game timeout */
+    const char *metrics_path;           /* stats file, NULL for none */
+    const struct score_geometry *geometry;
+    uint8_t secret[SCORE_MAX_SLOTS];
+    const struct score_table *table;    /* answers for the secret, NULL for an evil host */
+    int evil;                           /* evil host without a secret */
+};
 
-#ifdef ENDEBUG
-#define DEBUG(...) do { fprintf(stderr, __VA_ARGS__); } while(0)
-#else
-#define DEBUG(...)
-#endif
+/* State of one connection, all games of a loop play the secret of its score table or against the evil host */
+struct game {
+    int32_t fd;
+    uint32_t id;                    /* tells completions of a closed game from those of the next one on fd */
+    uint32_t io;                    /* slab index of the buffers, SLAB_NONE while idle */
+    uint32_t set;                   /* slab index of the codes left by the evil host, SLAB_NONE before
+                                       the first guess */
+    struct wheel_timer timer;       /* due at the earlier of both deadlines, or before */
+    uint32_t started;               /* tick of the accept */
+    uint32_t active;                /* tick of the last request */
+    uint8_t round;                  /* rounds played */
+    uint8_t flags;                  /* GAME_* */
+};
+
+/* Buffers of a game with bytes in flight */
+struct game_io {
+    uint16_t buffered;              /* bytes of an incomplete request or frame in `in` */
+    uint16_t sent;                  /* bytes of `out` already sent */
+    uint16_t pending;               /* bytes in `out` */
+    uint8_t in[IN_BYTES];
+    uint8_t out[OUT_BYTES];
+};
+
+/* Operations of io_uring requests */
+enum ring_op { RING_STOP = 1, RING_ACCEPT, RING_RECV, RING_SEND, RING_TIMER };
+
+/* An event loop with its own listener and game table */
+struct server {
+    int listenfd;
+    int epfd;                       /* -1 if the loop uses io_uring */
+    int uring;
+    struct uring ring;
+    struct uring_buffers buffers;   /* picked by the multishot receives */
+    int stopfd;                     /* readable when the loop should stop */
+    int timerfd;                    /* expires every tick, -1 without timeouts */
+    uint64_t expirations;           /* read from timerfd by io_uring */
+    uint64_t epoch;                 /* now() at tick 0 */
+    uint32_t idle_ticks;            /* 0 for no idle timeout */
+    uint32_t game_ticks;            /* 0 for no game timeout */
+    struct wheel wheel;             /* timers of the games */
+    pthread_t thread;
+    const struct score_geometry *geometry;
+    const struct score_table *table;    /* answers for the secret, NULL for an evil host */
+    const struct evil *evil;        /* planes of the evil host, NULL for a fixed secret */
+    struct metrics *metrics;        /* counters of this loop */
+    struct slab records;            /* struct game */
+    struct slab ios;                /* struct game_io */
+    struct slab sets;               /* struct evil_set */
+    uint32_t *games;                /* record of every file descriptor, SLAB_NONE for none */
+    size_t capacity;                /* entries of `games` */
+    size_t active;                  /* open connections */
+    uint32_t ids;                   /* id of the next game */
+};
 
-/* Length of an array */
-#define COUNT_OF(x) (sizeof(x)/sizeof(x[0]))
 
 /* === Global Variables === */
 
 /* Name of the program */
 static const char *progname = "server"; /* default name */
 
-/* File descriptor for server socket */
-static int sockfd = -1;
+/* One event loop per worker */
+static struct server *servers = NULL;
+static long int nservers = 0;
 
-/* File descriptor for connection socket */
-static int connfd = -1;
-
-/* This variable is set upon receipt of a signal */
-volatile sig_atomic_t quit = 0;
+/* Event file descriptor which stops all workers */
+static int stopfd = -1;
 
+/* Counters of all workers */
+static struct metrics_file metrics;
 
-/* === Type Definitions === */
+/* Codes of the geometry for the evil host, NULL for a fixed secret */
+static struct evil *evil = NULL;
 
-struct opts {
-    long int portno;
-    uint8_t secret[SLOTS];
-};
+/* This variable is set upon receipt of a signal */
+volatile sig_atomic_t quit = 0;
 
 
 /* === Prototypes === */
@@ -106,25 +212,301 @@ struct opts {
 static void parse_args(int argc, char **argv, struct opts *options);
 
 /**
- * @brief Read message from socket
- *
- * This code *illustrates* one way to deal with partial reads
- *
- * @param sockfd_con Socket to read from
- * @param buffer Buffer where read data is stored
- * @param n Size to read
- * @return Pointer to buffer on success, else NULL
+ * @brief Compute answer to request
+ * @details one load from the score table of the secret, which includes the parity check
+ * @param req Client's guess
+ * @param resp Buffer that will be sent to the client
+ * @param table Score table of the server's secret
+ * @return Number of correct matches on success; -1 in case of a parity error
  */
-static uint8_t *read_from_client(int sockfd_con, uint8_t *buffer, size_t n);
+static int compute_answer(uint16_t req, uint8_t *resp, const struct score_table *table);
 
 /**
- * @brief Compute answer to request
+ * @brief Compute answer to request as an evil host
+ * @details the first guess of a game attaches the set of all codes
+ * @param srv The event loop
+ * @param game The game
  * @param req Client's guess
  * @param resp Buffer that will be sent to the client
- * @param secret The server's secret
- * @return Number of correct matches on success; -1 in case of a parity error
+ * @return Number of correct matches on success; -1 in case of a parity error or if out of memory
+ */
+static int compute_evil_answer(struct server *srv, struct game *game, uint16_t req, uint8_t *resp);
+
+/**
+ * @brief Create a non-blocking listening socket
+ * @param portno Port to bind to
+ * @param reuseport Set SO_REUSEPORT, so that every worker can bind its own socket
+ * @return File descriptor on success, -1 on error
+ */
+static int create_listener(long int portno, int reuseport);
+
+/**
+ * @brief Set up an event loop
+ * @param srv The event loop
+ * @param listenfd Non-blocking listening socket, owned by the loop
+ * @param counters Counters of the loop
+ * @param options Backend, timeouts and score table or evil host of the server, the loop takes its own table
+ *        reference
+ * @return 0 on success, -1 on error
+ */
+static int server_init(struct server *srv, int listenfd, struct metrics *counters, const struct opts *options);
+
+/**
+ * @brief Run an event loop until a signal is caught or the workers are stopped
+ * @param srv The event loop
+ * @param sigmask Signal mask while waiting for events, NULL to keep the current one
+ * @return 0 on success, -1 on error
+ */
+static int server_run(struct server *srv, const sigset_t *sigmask);
+
+/**
+ * @brief Run an io_uring event loop
+ * @details every io_uring_enter() submits the requests queued for all
+ * completions of the last one, and then waits for new completions
+ * @param srv The event loop
+ * @param sigmask Signal mask while waiting for completions, NULL to keep the current one
+ * @return 0 on success, -1 on error
+ */
+static int server_run_ring(struct server *srv, const sigset_t *sigmask);
+
+/**
+ * @brief Close the games whose deadline passed, up to the current tick
+ * @param srv The event loop
+ */
+static void expire_games(struct server *srv);
+
+/**
+ * @brief Handle the expired timer of a game
+ * @details the timer is not moved on every request, so it may be early: then it is
+ * added again for the real deadline
+ * @param arg The event loop
+ * @param record Slab index of the game
+ */
+static void expire_game(void *arg, uint32_t record);
+
+/**
+ * @brief Deadline of a game
+ * @param srv The event loop, with at least one timeout
+ * @param game The game
+ * @return the earlier tick of the idle and the game timeout
+ */
+static uint32_t game_deadline(const struct server *srv, const struct game *game);
+
+/**
+ * @brief Close all connections and the listener of an event loop
+ * @param srv The event loop
+ */
+static void server_free(struct server *srv);
+
+/**
+ * @brief Entry point of a worker thread
+ * @param arg The event loop of the worker
+ * @return NULL
+ */
+static void *worker_main(void *arg);
+
+/**
+ * @brief Make all event loops return
+ */
+static void stop_workers(void);
+
+/**
+ * @brief Accept all pending connections
+ * @param srv The event loop
+ */
+static void accept_clients(struct server *srv);
+
+/**
+ * @brief Start a game on an accepted connection
+ * @param srv The event loop
+ * @param fd The connection
+ * @return the game, NULL on error with fd closed
+ */
+static struct game *open_game(struct server *srv, int fd);
+
+/**
+ * @brief The game of a connection
+ * @param srv The event loop
+ * @param fd The connection
+ * @return the game, NULL if fd has none
+ */
+static struct game *find_game(struct server *srv, int fd);
+
+/**
+ * @brief Attach buffers to a game
+ * @param srv The event loop
+ * @param game The connection
+ * @return the buffers, NULL if out of memory
+ */
+static struct game_io *attach_io(struct server *srv, struct game *game);
+
+/**
+ * @brief Forget sent answers, and give the buffers back if nothing is left in them
+ * @param srv The event loop
+ * @param game The connection
+ */
+static void release_io(struct server *srv, struct game *game);
+
+/**
+ * @brief Read requests from a connection and answer all complete ones
+ * @param srv The event loop
+ * @param game The connection, may be closed
+ */
+static void handle_input(struct server *srv, struct game *game);
+
+/**
+ * @brief Answer all complete requests of the received bytes
+ * @details keeps an incomplete request for the next bytes, the answers are
+ * queued in the output buffer of the game
+ * @param srv The event loop
+ * @param game The connection
+ * @param io Buffers of the connection
+ * @param data Received bytes
+ * @param length Number of received bytes, at most CHUNK_BYTES
+ */
+static void consume_input(struct server *srv, struct game *game, struct game_io *io,
+                          const uint8_t *data, size_t length);
+
+/**
+ * @brief Record the service time of requests answered since start
+ * @details the requests of one read share its service time
+ * @param srv The event loop
+ * @param start Time before the requests were read
+ * @param requests Requests answered before
+ */
+static void record_service(struct server *srv, uint64_t start, uint64_t requests);
+
+/**
+ * @brief Answer a single request of the original protocol
+ * @details the hello in the first request switches to the batch protocol
+ * @param srv The event loop
+ * @param game The connection
+ * @param io Buffers of the connection
+ * @param data Received bytes
+ * @param length Number of received bytes
+ * @return Bytes used, 0 if the request is incomplete
+ */
+static size_t play_request(struct server *srv, struct game *game, struct game_io *io,
+                           const uint8_t *data, size_t length);
+
+/**
+ * @brief Answer a frame of the batch protocol
+ * @details guesses after the end of the game are not answered, a frame with
+ * a bad count ends the game without an answer
+ * @param srv The event loop
+ * @param game The connection
+ * @param io Buffers of the connection
+ * @param data Received bytes
+ * @param length Number of received bytes
+ * @return Bytes used, 0 if the frame is incomplete
+ */
+static size_t play_frame(struct server *srv, struct game *game, struct game_io *io,
+                         const uint8_t *data, size_t length);
+
+/**
+ * @brief Play one round of a game
+ * @details queues the answer and marks the game as over after the last round
+ * @param srv The event loop
+ * @param game The connection
+ * @param io Buffers of the connection
+ * @param request Client's guess
+ */
+static void play_round(struct server *srv, struct game *game, struct game_io *io, uint16_t request);
+
+/**
+ * @brief Send queued answers
+ * @details waits for EPOLLOUT if the socket is full, closes the connection
+ * when the game is over and everything is sent
+ * @param srv The event loop
+ * @param game The connection, may be closed
+ */
+static void flush_output(struct server *srv, struct game *game);
+
+/**
+ * @brief Change the events a connection waits for
+ * @param srv The event loop
+ * @param game The connection
+ * @param output Wait for EPOLLOUT instead of EPOLLIN
+ * @return 0 on success, -1 on error
+ */
+static int watch(struct server *srv, struct game *game, int output);
+
+/**
+ * @brief Queue a multishot accept on the listener of an io_uring loop
+ * @param srv The event loop
+ * @return 0 on success, -1 on error
+ */
+static int arm_accept(struct server *srv);
+
+/**
+ * @brief Queue a multishot receive on a connection of an io_uring loop
+ * @param srv The event loop
+ * @param game The connection
+ * @return 0 on success, -1 on error
+ */
+static int arm_recv(struct server *srv, struct game *game);
+
+/**
+ * @brief Queue a read of the expirations of the timerfd of an io_uring loop
+ * @param srv The event loop
+ * @return 0 on success, -1 on error
+ */
+static int arm_timer(struct server *srv);
+
+/**
+ * @brief Start games on connections accepted by io_uring
+ * @param srv The event loop
+ * @param res The connection, or a negative error number
+ * @param flags Flags of the completion
  */
-static int compute_answer(uint16_t req, uint8_t *resp, uint8_t *secret);
+static void complete_accept(struct server *srv, int32_t res, uint32_t flags);
+
+/**
+ * @brief Answer the requests received by io_uring
+ * @param srv The event loop
+ * @param data user_data of the receive
+ * @param res Number of received bytes, or a negative error number
+ * @param flags Flags of the completion, naming the receive buffer
+ */
+static void complete_recv(struct server *srv, uint64_t data, int32_t res, uint32_t flags);
+
+/**
+ * @brief Continue after io_uring sent answers
+ * @param srv The event loop
+ * @param data user_data of the send
+ * @param res Number of sent bytes, or a negative error number
+ */
+static void complete_send(struct server *srv, uint64_t data, int32_t res);
+
+/**
+ * @brief Queue a send of the unsent answers of a connection of an io_uring loop
+ * @details only one send per connection is in flight, its completion queues
+ * the rest; closes the connection when the game is over and everything is sent
+ * @param srv The event loop
+ * @param game The connection, may be closed
+ */
+static void queue_output(struct server *srv, struct game *game);
+
+/**
+ * @brief The game a completion of an io_uring loop belongs to
+ * @param srv The event loop
+ * @param data user_data of the request
+ * @return the game, NULL if it has been closed meanwhile
+ */
+static struct game *ring_game(struct server *srv, uint64_t data);
+
+/**
+ * @brief Close a connection and free its game
+ * @param srv The event loop
+ * @param game The connection
+ */
+static void close_game(struct server *srv, struct game *game);
+
+/**
+ * @brief Current time
+ * @return nanoseconds of CLOCK_MONOTONIC
+ */
+static uint64_t now(void);
 
 /**
  * @brief terminate program on program error
@@ -147,77 +529,900 @@ static void free_resources(void);
 
 /* === Implementations === */
 
-static uint8_t *read_from_client(int fd, uint8_t *buffer, size_t n)
+static int compute_answer(uint16_t req, uint8_t *resp, const struct score_table *table)
+{
+    /* build response buffer */
+    resp[0] = table->answers[req];
+    if (resp[0] & (1 << PARITY_ERR_BIT)) {
+        return -1;
+    } else {
+        return resp[0] & ((1 << SHIFT_WIDTH) - 1);
+    }
+}
+
+static int compute_evil_answer(struct server *srv, struct game *game, uint16_t req, uint8_t *resp)
+{
+    struct evil_set *set;
+
+    if (game->set == SLAB_NONE) {
+        game->set = slab_alloc(&srv->sets);
+        if (game->set == SLAB_NONE) {
+            /* give up the game, it does not count as lost */
+            game->flags |= GAME_OVER;
+            resp[0] = 1 << GAME_LOST_ERR_BIT;
+            return -1;
+        }
+        (void) memcpy(slab_get(&srv->sets, game->set), &srv->evil->all, sizeof(*set));
+    }
+    set = slab_get(&srv->sets, game->set);
+
+    /* like the score table, a parity error still carries the score; the game ends, so its set may shrink */
+    resp[0] = evil_answer(srv->evil, set, req);
+    if ((req & (1 << PARITY_BIT)) != srv->geometry->parity(req & CODE_MASK)) {
+        resp[0] |= 1 << PARITY_ERR_BIT;
+        return -1;
+    }
+    return resp[0] & ((1 << SHIFT_WIDTH) - 1);
+}
+
+static int create_listener(long int portno, int reuseport)
+{
+    struct sockaddr_in binding_address;
+    int val = 1;
+    int fd;
+
+    //Create non-blocking TCP/IP socket
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+
+    //Set SO_REUSEADDR, and SO_REUSEPORT for workers
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val)) < 0
+        || (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) < 0)) {
+        (void) close(fd);
+        return -1;
+    }
+
+    //Bind Address
+    (void) memset(&binding_address, 0, sizeof(binding_address));
+    binding_address.sin_family = AF_INET;
+    binding_address.sin_addr.s_addr = INADDR_ANY;
+    binding_address.sin_port = htons(portno);
+
+    //Bind and listen
+    if (bind(fd, (struct sockaddr *) &binding_address, sizeof(binding_address)) < 0
+        || listen(fd, BACKLOG) < 0) {
+        (void) close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int server_init(struct server *srv, int listenfd, struct metrics *counters, const struct opts *options)
+{
+    const struct score_table *table = options->table;
+    const int uring = options->uring;
+    struct io_uring_sqe *sqe;
+    struct epoll_event ev;
+
+    srv->listenfd = listenfd;
+    srv->uring = uring;
+    srv->metrics = counters;
+    srv->stopfd = stopfd;
+    srv->geometry = options->geometry;
+    srv->evil = evil;
+    if (table != NULL) {
+        srv->table = score_table_get(table->geometry, table->secret);
+        if (srv->table == NULL) {
+            return -1;
+        }
+    }
+    srv->active = 0;
+    slab_init(&srv->records, sizeof(struct game), GAME_SHIFT);
+    slab_init(&srv->ios, sizeof(struct game_io), IO_SHIFT);
+    slab_init(&srv->sets, sizeof(struct evil_set), SET_SHIFT);
+    srv->capacity = INITIAL_GAMES;
+    srv->games = malloc(srv->capacity * sizeof(*srv->games));
+    if (srv->games == NULL) {
+        return -1;
+    }
+    (void) memset(srv->games, 0xff, srv->capacity * sizeof(*srv->games));
+
+    /* one timerfd ticks all timeouts of the loop */
+    wheel_init(&srv->wheel, &srv->records, offsetof(struct game, timer));
+    srv->idle_ticks = (uint32_t) (options->idle_seconds * (1000000000 / TICK_NS));
+    srv->game_ticks = (uint32_t) (options->game_seconds * (1000000000 / TICK_NS));
+    if (srv->idle_ticks != 0 || srv->game_ticks != 0) {
+        struct itimerspec tick = { { 0, TICK_NS }, { 0, TICK_NS } };
+
+        srv->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (srv->timerfd < 0 || timerfd_settime(srv->timerfd, 0, &tick, NULL) < 0) {
+            return -1;
+        }
+        srv->epoch = now();
+    }
+
+    if (uring) {
+        if (uring_init(&srv->ring, URING_ENTRIES) < 0
+            || uring_buffers_init(&srv->ring, &srv->buffers, 0, URING_BUFFERS, CHUNK_BYTES) < 0) {
+            return -1;
+        }
+
+        /* io_uring waits for blocking sockets by itself */
+        if (fcntl(listenfd, F_SETFL, 0) < 0 || arm_accept(srv) < 0) {
+            return -1;
+        }
+
+        /* never read, so it completes in every loop */
+        sqe = uring_sqe(&srv->ring);
+        if (sqe == NULL) {
+            return -1;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = srv->stopfd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = RING_DATA(RING_STOP, 0, srv->stopfd);
+        return srv->timerfd >= 0 ? arm_timer(srv) : 0;
+    }
+
+    srv->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (srv->epfd < 0) {
+        return -1;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.fd = listenfd;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, listenfd, &ev) < 0) {
+        return -1;
+    }
+
+    if (srv->timerfd >= 0) {
+        ev.events = EPOLLIN;
+        ev.data.fd = srv->timerfd;
+        if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->timerfd, &ev) < 0) {
+            return -1;
+        }
+    }
+
+    /* never read, so it wakes up every loop */
+    ev.events = EPOLLIN;
+    ev.data.fd = srv->stopfd;
+    return epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->stopfd, &ev);
+}
+
+static int server_run(struct server *srv, const sigset_t *sigmask)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    if (srv->uring) {
+        return server_run_ring(srv, sigmask);
+    }
+
+    while (!quit) {
+        int n = epoll_pwait(srv->epfd, events, MAX_EVENTS, -1, sigmask);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            struct game *game;
+
+            if (fd == srv->stopfd) {
+                return 0;
+            }
+            if (fd == srv->listenfd) {
+                accept_clients(srv);
+                continue;
+            }
+            if (fd == srv->timerfd) {
+                (void) read(srv->timerfd, &srv->expirations, sizeof(srv->expirations));
+                expire_games(srv);
+                continue;
+            }
+
+            /* the game may have been closed by an earlier event */
+            game = find_game(srv, fd);
+            if (game != NULL && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                && (game->flags & GAME_OUTPUT)) {
+                flush_output(srv, game);
+                game = find_game(srv, fd);
+            }
+            if (game != NULL && !(game->flags & GAME_OUTPUT)) {
+                handle_input(srv, game);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int server_run_ring(struct server *srv, const sigset_t *sigmask)
+{
+    while (!quit) {
+        struct io_uring_cqe *cqe;
+
+        /* EBUSY: the completion queue overflowed, make room first */
+        if (uring_enter(&srv->ring, 1, sigmask) < 0 && errno != EINTR && errno != EBUSY) {
+            return -1;
+        }
+
+        while ((cqe = uring_cqe(&srv->ring)) != NULL) {
+            uint64_t data = cqe->user_data;
+            int32_t res = cqe->res;
+            uint32_t flags = cqe->flags;
+
+            uring_cqe_seen(&srv->ring);
+            switch (RING_OP(data)) {
+                case RING_STOP:
+                    return 0;
+                case RING_ACCEPT:
+                    complete_accept(srv, res, flags);
+                    break;
+                case RING_RECV:
+                    complete_recv(srv, data, res, flags);
+                    break;
+                case RING_SEND:
+                    complete_send(srv, data, res);
+                    break;
+                case RING_TIMER:
+                    expire_games(srv);
+                    if (arm_timer(srv) < 0) {
+                        return -1;
+                    }
+                    break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void expire_games(struct server *srv)
+{
+    wheel_advance(&srv->wheel, (uint32_t) ((now() - srv->epoch) / TICK_NS), expire_game, srv);
+}
+
+static void expire_game(void *arg, uint32_t record)
+{
+    struct server *srv = arg;
+    struct game *game = slab_get(&srv->records, record);
+    const uint32_t deadline = game_deadline(srv, game);
+
+    if ((int32_t) (deadline - srv->wheel.now) > 0) {
+        wheel_add(&srv->wheel, record, deadline);
+        return;
+    }
+
+    if (srv->game_ticks != 0 && (int32_t) (game->started + srv->game_ticks - srv->wheel.now) <= 0) {
+        DEBUG("Game %d: game timeout\n", game->fd);
+        srv->metrics->game_timeouts++;
+    } else {
+        DEBUG("Game %d: idle timeout\n", game->fd);
+        srv->metrics->idle_timeouts++;
+    }
+
+    /* the send in flight still reads the buffers, its completion closes the game */
+    if (srv->uring && (game->flags & GAME_OUTPUT)) {
+        game->flags |= GAME_OVER;
+        (void) shutdown(game->fd, SHUT_RDWR);
+        return;
+    }
+    close_game(srv, game);
+}
+
+static uint32_t game_deadline(const struct server *srv, const struct game *game)
+{
+    const uint32_t idle = game->active + srv->idle_ticks;
+    const uint32_t total = game->started + srv->game_ticks;
+
+    if (srv->game_ticks == 0) {
+        return idle;
+    }
+    if (srv->idle_ticks == 0) {
+        return total;
+    }
+    return (int32_t) (total - idle) < 0 ? total : idle;
+}
+
+static void server_free(struct server *srv)
+{
+    /* cancels all requests before their games are freed */
+    uring_buffers_free(&srv->ring, &srv->buffers);
+    uring_free(&srv->ring);
+    if (srv->timerfd >= 0) {
+        (void) close(srv->timerfd);
+        srv->timerfd = -1;
+    }
+
+    if (srv->games != NULL) {
+        for (size_t fd = 0; fd < srv->capacity; fd++) {
+            if (srv->games[fd] != SLAB_NONE) {
+                close_game(srv, find_game(srv, (int) fd));
+            }
+        }
+        free(srv->games);
+        srv->games = NULL;
+    }
+    slab_destroy(&srv->records);
+    slab_destroy(&srv->ios);
+    slab_destroy(&srv->sets);
+    if (srv->epfd >= 0) {
+        (void) close(srv->epfd);
+        srv->epfd = -1;
+    }
+    if (srv->listenfd >= 0) {
+        (void) close(srv->listenfd);
+        srv->listenfd = -1;
+    }
+    score_table_put(srv->table);
+    srv->table = NULL;
+}
+
+static void *worker_main(void *arg)
+{
+    struct server *srv = arg;
+
+    /* SIGINT and SIGTERM stay blocked, the main thread handles them */
+    if (server_run(srv, NULL) < 0) {
+        (void) fprintf(stderr, "%s: %s: %s\n", progname,
+            srv->uring ? "io_uring_enter" : "epoll_wait", strerror(errno));
+        stop_workers();
+    }
+    return NULL;
+}
+
+static void stop_workers(void)
+{
+    uint64_t one = 1;
+
+    (void) write(stopfd, &one, sizeof(one));
+}
+
+static void accept_clients(struct server *srv)
 {
-    /* loop, as packet can arrive in several partial reads */
-    size_t bytes_recv = 0;
-    do {
-        ssize_t r;
-        r = recv(fd, buffer + bytes_recv, n - bytes_recv, 0);
-        if (r <= 0) {
+    for (;;) {
+        struct epoll_event ev;
+        struct game *game;
+        int fd;
+
+        fd = accept4(srv->listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR
+                && errno != ECONNABORTED) {
+                (void) fprintf(stderr, "%s: accept: %s\n", progname, strerror(errno));
+            }
+            return;
+        }
+
+        game = open_game(srv, fd);
+        if (game == NULL) {
+            continue;
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close_game(srv, game);
+        }
+    }
+}
+
+static struct game *open_game(struct server *srv, int fd)
+{
+    struct game *game;
+    uint32_t record;
+    int val = 1;
+    int bytes = SOCKET_BYTES;
+
+    /* answers are single bytes, do not delay them */
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+    (void) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    (void) setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+
+    if ((size_t) fd >= srv->capacity) {
+        size_t capacity = srv->capacity;
+        uint32_t *games;
+
+        while ((size_t) fd >= capacity) {
+            capacity *= 2;
+        }
+        games = realloc(srv->games, capacity * sizeof(*games));
+        if (games == NULL) {
+            (void) close(fd);
             return NULL;
         }
-        bytes_recv += r;
-    } while (bytes_recv < n);
+        (void) memset(games + srv->capacity, 0xff, (capacity - srv->capacity) * sizeof(*games));
+        srv->games = games;
+        srv->capacity = capacity;
+    }
+
+    record = slab_alloc(&srv->records);
+    if (record == SLAB_NONE) {
+        (void) close(fd);
+        return NULL;
+    }
+    game = slab_get(&srv->records, record);
+    game->fd = fd;
+    game->id = srv->ids++;
+    game->io = SLAB_NONE;
+    game->set = SLAB_NONE;
+    game->round = 0;
+    game->flags = 0;
+    game->started = game->active = srv->wheel.now;
+    game->timer.slot = SLAB_NONE;
+    if (srv->timerfd >= 0) {
+        wheel_add(&srv->wheel, record, game_deadline(srv, game));
+    }
+
+    srv->games[fd] = record;
+    srv->active++;
+    srv->metrics->active++;
+    srv->metrics->started++;
+    DEBUG("Accepted connection %d\n", fd);
+    return game;
+}
 
-    if (bytes_recv < n) {
+static struct game *find_game(struct server *srv, int fd)
+{
+    if ((size_t) fd >= srv->capacity || srv->games[fd] == SLAB_NONE) {
         return NULL;
     }
-    return buffer;
+    return slab_get(&srv->records, srv->games[fd]);
+}
+
+static struct game_io *attach_io(struct server *srv, struct game *game)
+{
+    struct game_io *io;
+
+    if (game->io == SLAB_NONE) {
+        game->io = slab_alloc(&srv->ios);
+        if (game->io == SLAB_NONE) {
+            return NULL;
+        }
+        io = slab_get(&srv->ios, game->io);
+        io->buffered = io->sent = io->pending = 0;
+        return io;
+    }
+    return slab_get(&srv->ios, game->io);
 }
 
-static int compute_answer(uint16_t req, uint8_t *resp, uint8_t *secret)
+static void release_io(struct server *srv, struct game *game)
 {
-    int colors_left[COLORS];
-    int guess[COLORS];
-    uint8_t parity_calc, parity_recv;
-    int red, white;
-    int j;
+    struct game_io *io;
+
+    if (game->io == SLAB_NONE) {
+        return;
+    }
+    io = slab_get(&srv->ios, game->io);
+    io->sent = io->pending = 0;
+    if (io->buffered == 0) {
+        slab_release(&srv->ios, game->io);
+        game->io = SLAB_NONE;
+    }
+}
+
+static void handle_input(struct server *srv, struct game *game)
+{
+    uint8_t chunk[CHUNK_BYTES];
+    struct game_io *io;
+    uint64_t start;
+    uint64_t requests;
+    ssize_t r;
+
+    r = recv(game->fd, chunk, sizeof(chunk), 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    io = r > 0 ? attach_io(srv, game) : NULL;
+    if (io == NULL) {
+        /* client left, connection broken or out of memory */
+        close_game(srv, game);
+        return;
+    }
+
+    start = now();
+    requests = srv->metrics->requests;
+
+    consume_input(srv, game, io, chunk, r);
+    flush_output(srv, game);
+
+    record_service(srv, start, requests);
+}
+
+static void consume_input(struct server *srv, struct game *game, struct game_io *io,
+                          const uint8_t *data, size_t length)
+{
+    uint8_t chunk[IN_BYTES + CHUNK_BYTES];
+    size_t i;
+
+    /* moves the idle deadline, the timer catches up when it expires */
+    game->active = srv->wheel.now;
 
-    parity_recv = (req >> 15) & 1;
+    /* buffers of other games share the slab chunk, never write past io->in */
+    assert(io->buffered <= sizeof(io->in) && length <= CHUNK_BYTES);
 
-    /* extract the guess and calculate parity */
-    parity_calc = 0;
-    for (j = 0; j < SLOTS; ++j) {
-        int tmp = req & 0x7;
-        parity_calc ^= tmp ^ (tmp >> 1) ^ (tmp >> 2);
-        guess[j] = tmp;
-        req >>= SHIFT_WIDTH;
+    /* join an incomplete request with the new bytes */
+    if (io->buffered > 0) {
+        (void) memcpy(chunk, io->in, io->buffered);
+        (void) memcpy(chunk + io->buffered, data, length);
+        data = chunk;
+        length += io->buffered;
     }
-    parity_calc &= 0x1;
 
-    /* marking red and white */
-    (void) memset(&colors_left[0], 0, sizeof(colors_left));
-    red = white = 0;
-    for (j = 0; j < SLOTS; ++j) {
-        /* mark red */
-        if (guess[j] == secret[j]) {
-            red++;
+    for (i = 0; i < length && !(game->flags & GAME_OVER); ) {
+        size_t used;
+
+        if (game->flags & GAME_BATCH) {
+            used = play_frame(srv, game, io, data + i, length - i);
         } else {
-            colors_left[secret[j]]++;
+            used = play_request(srv, game, io, data + i, length - i);
+        }
+        if (used == 0) {
+            break;
+        }
+        i += used;
+    }
+
+    /* a running game leaves at most an incomplete frame, anything longer is no request */
+    if (length - i > sizeof(io->in)) {
+        DEBUG("Game %d: %zu bytes left over\n", game->fd, length - i);
+        game->flags |= GAME_OVER;
+    }
+
+    /* keep an incomplete request for the next read, bytes after the end of the game are dropped */
+    if (game->flags & GAME_OVER) {
+        io->buffered = 0;
+        return;
+    }
+    io->buffered = (uint16_t) (length - i);
+    assert(io->buffered <= sizeof(io->in));
+    (void) memcpy(io->in, data + i, io->buffered);
+}
+
+static void record_service(struct server *srv, uint64_t start, uint64_t requests)
+{
+    requests = srv->metrics->requests - requests;
+    if (requests > 0) {
+        hdr_record_n(&srv->metrics->service, (now() - start) / requests, requests);
+    }
+}
+
+static size_t play_request(struct server *srv, struct game *game, struct game_io *io,
+                           const uint8_t *data, size_t length)
+{
+    uint16_t request;
+
+    if (length < READ_BYTES) {
+        return 0;
+    }
+    request = (uint16_t) ((data[1] << 8) | data[0]);
+
+    if (game->round == 0 && request == BATCH_HELLO) {
+        DEBUG("Game %d: batch protocol\n", game->fd);
+        game->flags |= GAME_BATCH;
+        io->out[io->pending++] = BATCH_ACK;
+    } else {
+        play_round(srv, game, io, request);
+    }
+    return READ_BYTES;
+}
+
+static size_t play_frame(struct server *srv, struct game *game, struct game_io *io,
+                         const uint8_t *data, size_t length)
+{
+    size_t count_at;
+    unsigned int count;
+    unsigned int played;
+
+    count = data[0];
+    if (count == 0 || count > MAX_BATCH) {
+        DEBUG("Game %d: bad frame of %u guesses\n", game->fd, count);
+        game->flags |= GAME_OVER;
+        return length;
+    }
+    if (length < BATCH_FRAME_BYTES(count)) {
+        return 0;
+    }
+
+    /* answers carry the sequence number of their guess */
+    count_at = io->pending++;
+    for (played = 0; played < count && !(game->flags & GAME_OVER); played++) {
+        const uint8_t *guess = data + 1 + played * BATCH_GUESS_BYTES;
+
+        io->out[io->pending++] = guess[0];
+        play_round(srv, game, io, (uint16_t) ((guess[2] << 8) | guess[1]));
+    }
+    io->out[count_at] = (uint8_t) played;
+
+    return BATCH_FRAME_BYTES(count);
+}
+
+static void play_round(struct server *srv, struct game *game, struct game_io *io, uint16_t request)
+{
+    uint8_t answer;
+    int correct_guesses;
+
+    game->round++;
+    DEBUG("Game %d, round %d: Received 0x%x\n", game->fd, game->round, request);
+
+    if (srv->evil != NULL) {
+        correct_guesses = compute_evil_answer(srv, game, request, &answer);
+    } else {
+        correct_guesses = compute_answer(request, &answer, srv->table);
+    }
+    if (game->round == MAX_TRIES && correct_guesses != srv->geometry->slots) {
+        answer |= 1 << GAME_LOST_ERR_BIT;
+    }
+
+    DEBUG("Sending byte 0x%x\n", answer);
+    io->out[io->pending++] = answer;
+    srv->metrics->requests++;
+
+    /* stop the game if it is over, or an error occured */
+    if (answer & (1 << PARITY_ERR_BIT)) {
+        DEBUG("Game %d: parity error\n", game->fd);
+        srv->metrics->parity_errors++;
+        game->flags |= GAME_OVER;
+    }
+    if (answer & (1 << GAME_LOST_ERR_BIT)) {
+        DEBUG("Game %d: lost\n", game->fd);
+        if (!(game->flags & GAME_OVER)) {
+            srv->metrics->lost++;
         }
+        game->flags |= GAME_OVER;
+    }
+    if (!(game->flags & GAME_OVER) && correct_guesses == srv->geometry->slots) {
+        /* won */
+        DEBUG("Game %d: won in %d rounds\n", game->fd, game->round);
+        srv->metrics->won++;
+        srv->metrics->rounds[game->round]++;
+        game->flags |= GAME_OVER;
     }
-    for (j = 0; j < SLOTS; ++j) {
-        /* not marked red */
-        if (guess[j] != secret[j]) {
-            if (colors_left[guess[j]] > 0) {
-                white++;
-                colors_left[guess[j]]--;
+}
+
+static void flush_output(struct server *srv, struct game *game)
+{
+    struct game_io *io = game->io != SLAB_NONE ? slab_get(&srv->ios, game->io) : NULL;
+
+    while (io != NULL && io->sent < io->pending) {
+        ssize_t s = send(game->fd, io->out + io->sent, io->pending - io->sent, MSG_NOSIGNAL);
+        if (s < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && watch(srv, game, 1) == 0) {
+                return;
             }
+            close_game(srv, game);
+            return;
         }
+        io->sent += s;
     }
+    release_io(srv, game);
 
-    /* build response buffer */
-    resp[0] = red;
-    resp[0] |= (white << SHIFT_WIDTH);
-    if (parity_recv != parity_calc) {
-        resp[0] |= (1 << PARITY_ERR_BIT);
+    if (game->flags & GAME_OVER) {
+        close_game(srv, game);
+    } else if (watch(srv, game, 0) < 0) {
+        close_game(srv, game);
+    }
+}
+
+static int watch(struct server *srv, struct game *game, int output)
+{
+    struct epoll_event ev;
+
+    if (!(game->flags & GAME_OUTPUT) == !output) {
+        return 0;
+    }
+    ev.events = output ? EPOLLOUT : EPOLLIN;
+    ev.data.fd = game->fd;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_MOD, game->fd, &ev) < 0) {
+        return -1;
+    }
+    game->flags ^= GAME_OUTPUT;
+    return 0;
+}
+
+static int arm_accept(struct server *srv)
+{
+    struct io_uring_sqe *sqe = uring_sqe(&srv->ring);
+
+    if (sqe == NULL) {
         return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = srv->listenfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = RING_DATA(RING_ACCEPT, 0, srv->listenfd);
+    return 0;
+}
+
+static int arm_recv(struct server *srv, struct game *game)
+{
+    struct io_uring_sqe *sqe = uring_sqe(&srv->ring);
+
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = game->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = srv->buffers.group;
+    sqe->user_data = RING_DATA(RING_RECV, game->id, game->fd);
+    return 0;
+}
+
+static int arm_timer(struct server *srv)
+{
+    struct io_uring_sqe *sqe = uring_sqe(&srv->ring);
+
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = srv->timerfd;
+    sqe->addr = (uintptr_t) &srv->expirations;
+    sqe->len = sizeof(srv->expirations);
+    sqe->user_data = RING_DATA(RING_TIMER, 0, srv->timerfd);
+    return 0;
+}
+
+static void complete_accept(struct server *srv, int32_t res, uint32_t flags)
+{
+    if (res >= 0) {
+        struct game *game = open_game(srv, res);
+
+        if (game != NULL && arm_recv(srv, game) < 0) {
+            close_game(srv, game);
+        }
+    } else if (res != -EAGAIN && res != -EINTR && res != -ECONNABORTED) {
+        (void) fprintf(stderr, "%s: accept: %s\n", progname, strerror(-res));
+    }
+
+    /* a multishot accept ends on errors */
+    if (!(flags & IORING_CQE_F_MORE) && arm_accept(srv) < 0) {
+        (void) fprintf(stderr, "%s: accept: %s\n", progname, strerror(errno));
+    }
+}
+
+static void complete_recv(struct server *srv, uint64_t data, int32_t res, uint32_t flags)
+{
+    struct game *game = ring_game(srv, data);
+    uint16_t buffer = (uint16_t) (flags >> IORING_CQE_BUFFER_SHIFT);
+    uint64_t start = 0;
+    uint64_t requests = 0;
+
+    if (game != NULL && res > 0) {
+        struct game_io *io = attach_io(srv, game);
+
+        start = now();
+        requests = srv->metrics->requests;
+        if (io != NULL) {
+            consume_input(srv, game, io, uring_buffer(&srv->buffers, buffer), res);
+        } else {
+            game->flags |= GAME_OVER;
+        }
+    }
+    if (flags & IORING_CQE_F_BUFFER) {
+        uring_buffer_put(&srv->buffers, buffer);
+    }
+    if (game == NULL) {
+        return;
+    }
+
+    /* the receive ends when it ran out of buffers, these are back by now */
+    if (res > 0 || res == -ENOBUFS) {
+        if (!(flags & IORING_CQE_F_MORE) && !(game->flags & GAME_OVER) && arm_recv(srv, game) < 0) {
+            game->flags |= GAME_OVER;
+        }
     } else {
-        return red;
+        /* client left or connection broken */
+        game->flags |= GAME_OVER;
+    }
+    queue_output(srv, game);
+
+    if (res > 0) {
+        record_service(srv, start, requests);
+    }
+}
+
+static void complete_send(struct server *srv, uint64_t data, int32_t res)
+{
+    struct game *game = ring_game(srv, data);
+
+    if (game == NULL) {
+        return;
+    }
+    game->flags &= ~GAME_OUTPUT;
+    if (res < 0) {
+        close_game(srv, game);
+        return;
+    }
+    ((struct game_io *) slab_get(&srv->ios, game->io))->sent += res;
+    queue_output(srv, game);
+}
+
+static void queue_output(struct server *srv, struct game *game)
+{
+    struct game_io *io = game->io != SLAB_NONE ? slab_get(&srv->ios, game->io) : NULL;
+    struct io_uring_sqe *sqe;
+
+    /* answers are only appended while a send is in flight, the buffers stay put */
+    if (game->flags & GAME_OUTPUT) {
+        return;
+    }
+    if (io != NULL && io->sent < io->pending) {
+        sqe = uring_sqe(&srv->ring);
+        if (sqe == NULL) {
+            close_game(srv, game);
+            return;
+        }
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = game->fd;
+        sqe->addr = (uintptr_t) (io->out + io->sent);
+        sqe->len = io->pending - io->sent;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = RING_DATA(RING_SEND, game->id, game->fd);
+        game->flags |= GAME_OUTPUT;
+        return;
+    }
+    release_io(srv, game);
+
+    if (game->flags & GAME_OVER) {
+        close_game(srv, game);
     }
 }
 
+static struct game *ring_game(struct server *srv, uint64_t data)
+{
+    struct game *game = find_game(srv, (int) RING_FD(data));
+
+    if (game == NULL || (game->id & 0xffffff) != RING_ID(data)) {
+        return NULL;
+    }
+    return game;
+}
+
+static void close_game(struct server *srv, struct game *game)
+{
+    const int fd = game->fd;
+
+    DEBUG("Closing connection %d\n", fd);
+    wheel_remove(&srv->wheel, srv->games[fd]);
+    if (game->io != SLAB_NONE) {
+        slab_release(&srv->ios, game->io);
+    }
+    if (game->set != SLAB_NONE) {
+        slab_release(&srv->sets, game->set);
+    }
+    slab_release(&srv->records, srv->games[fd]);
+    srv->games[fd] = SLAB_NONE;
+    srv->active--;
+    srv->metrics->active--;
+
+    /* a pending multishot receive holds its own reference to the socket */
+    if (srv->uring) {
+        (void) shutdown(fd, SHUT_RDWR);
+    }
+    (void) close(fd);
+}
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
 static void bail_out(int exitcode, const char *fmt, ...)
 {
     va_list ap;
@@ -241,12 +1446,18 @@ static void free_resources(void)
 {
     /* clean up resources */
     DEBUG("Shutting down server\n");
-    if(connfd >= 0) {
-        (void) close(connfd);
+    for (long int i = 0; i < nservers; i++) {
+        server_free(&servers[i]);
     }
-    if(sockfd >= 0) {
-        (void) close(sockfd);
+    free(servers);
+    servers = NULL;
+    nservers = 0;
+    if(stopfd >= 0) {
+        (void) close(stopfd);
     }
+    metrics_close(&metrics);
+    evil_destroy(evil);
+    evil = NULL;
 }
 
 static void signal_handler(int sig)
@@ -258,16 +1469,14 @@ static void signal_handler(int sig)
  * @brief Program entry point
  * @param argc The argument counter
  * @param argv The argument vector
- * @return EXIT_SUCCESS on success, EXIT_PARITY_ERROR in case of an parity
- * error, EXIT_GAME_LOST in case client needed to many guesses,
- * EXIT_MULTIPLE_ERRORS in case multiple errors occured in one round
+ * @return EXIT_SUCCESS after SIGINT or SIGTERM, EXIT_FAILURE on error
  */
 int main(int argc, char *argv[])
 {
 
     struct opts options;
-    int round;
-    int ret;
+    sigset_t blocked, unblocked;
+    int ret = EXIT_SUCCESS;
 
     parse_args(argc, argv, &options);
 
@@ -280,126 +1489,75 @@ int main(int argc, char *argv[])
     if(sigfillset(&s.sa_mask) < 0) {
         bail_out(EXIT_FAILURE, "sigfillset");
     }
+    (void) sigemptyset(&blocked);
     for(int i = 0; i < COUNT_OF(signals); i++) {
         if (sigaction(signals[i], &s, NULL) < 0) {
             bail_out(EXIT_FAILURE, "sigaction");
         }
+        (void) sigaddset(&blocked, signals[i]);
     }
 
-
-
-    /* Create a new TCP/IP socket `sockfd`, and set the SO_REUSEADDR
-       option for this socket. Then bind the socket to localhost:portno,
-       listen, and wait for new connections, which should be assigned to
-       `connfd`. Terminate the program in case of an error.
-    */
-
-    // ---------------------- MINE ----------------------
-
-    //Create TCP/IP socket
-    sockfd  = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
-    if(sockfd < 0){
-        bail_out(EXIT_FAILURE,"socket");
+    /* the signals are only delivered while the main thread waits for events,
+       so a signal can not get lost between checking `quit` and epoll_pwait().
+       Worker threads inherit the blocked mask. */
+    if (sigprocmask(SIG_BLOCK, &blocked, &unblocked) < 0) {
+        bail_out(EXIT_FAILURE, "sigprocmask");
     }
 
-    //Set SO_REUSEADDR
-    int val = 1;
-    if(setsockopt(sockfd,SOL_SOCKET,SO_REUSEADDR,&val, sizeof(val)) < 0){
-        bail_out(EXIT_FAILURE,"setsockopt SO_REUSEADDR");
+    stopfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stopfd < 0) {
+        bail_out(EXIT_FAILURE, "eventfd");
     }
 
-    //Bind Address
-    struct sockaddr_in binding_address;
-    binding_address.sin_family = AF_INET;
-    binding_address.sin_addr.s_addr = INADDR_ANY;
-    binding_address.sin_port = htons(options.portno);
-
-    //Bind
-    if(bind(sockfd, (struct sockaddr *) &binding_address, sizeof(binding_address)) < 0){
-        bail_out(EXIT_FAILURE,"bind");
+    //Counters of every worker
+    if (metrics_create(&metrics, options.metrics_path, options.workers) < 0) {
+        bail_out(EXIT_FAILURE, "metrics_create %s", options.metrics_path ? options.metrics_path : "");
     }
 
-    //Listen
-    if(listen(sockfd,BACKLOG) < 0){
-        bail_out(EXIT_FAILURE,"listen");
+    //One listener and event loop per worker
+    servers = calloc(options.workers, sizeof(*servers));
+    if (servers == NULL) {
+        bail_out(EXIT_FAILURE, "calloc");
     }
-
-    //Accept and wait
-    struct sockaddr_in client_address;
-    socklen_t client_address_length;
-    connfd = accept(sockfd, (struct sockaddr *) &client_address, &client_address_length);
-
-    // ---------------------- /MINE ----------------------
-
-    /* accepted the connection */
-    ret = EXIT_SUCCESS;
-    for (round = 1; round <= MAX_TRIES && !quit; ++round) {
-        uint16_t request;
-        static uint8_t buffer[BUFFER_BYTES];
-        int correct_guesses;
-        int error = 0;
-
-        /* read from client */
-        if (read_from_client(connfd, &buffer[0], READ_BYTES) == NULL) {
-            if (quit) break; /* caught signal */
-            bail_out(EXIT_FAILURE, "read_from_client");
+    for (nservers = 0; nservers < options.workers; nservers++) {
+        struct server *srv = &servers[nservers];
+        int listenfd;
+
+        srv->listenfd = srv->epfd = srv->ring.fd = srv->timerfd = -1;
+        listenfd = create_listener(options.portno, options.workers > 1);
+        if (listenfd < 0) {
+            bail_out(EXIT_FAILURE, "create_listener");
         }
-        request = (buffer[1] << 8) | buffer[0];
-        DEBUG("Round %d: Received 0x%x\n", round, request);
-
-        /* compute answer */
-        correct_guesses = compute_answer(request, buffer, options.secret);
-        if (round == MAX_TRIES && correct_guesses != SLOTS) {
-            buffer[0] |= 1 << GAME_LOST_ERR_BIT;
+        if (server_init(srv, listenfd, &metrics.workers[nservers], &options) < 0) {
+            (void) close(listenfd);
+            bail_out(EXIT_FAILURE, "server_init");
         }
-
-        DEBUG("Sending byte 0x%x\n", buffer[0]);
-
-        /* send message to client */
-
-        // ---------------------- MINE ----------------------
-
-        int bytes_send = 0;
-        int s = 0;
-
-        do{
-            s = write(connfd, buffer + bytes_send, WRITE_BYTES - bytes_send);
-
-            if(s < 0){
-                bail_out(EXIT_FAILURE,"send");
-            }
-
-            bytes_send += s;
-
-        }while (bytes_send < WRITE_BYTES);
-
-        // ---------------------- /MINE ----------------------
-
-        /* We sent the answer to the client; now stop the game
-           if its over, or an error occured */
-        if (*buffer & (1<<PARITY_ERR_BIT)) {
-            (void) fprintf(stderr, "Parity error\n");
-            error = 1;
-            ret = EXIT_PARITY_ERROR;
-        }
-        if (*buffer & (1 << GAME_LOST_ERR_BIT)) {
-            (void) fprintf(stderr, "Game lost\n");
-            error = 1;
-            if (ret == EXIT_PARITY_ERROR) {
-                ret = EXIT_MULTIPLE_ERRORS;
-            } else {
-                ret = EXIT_GAME_LOST;
+    }
+    score_table_put(options.table);
+
+    //The main thread is the first worker and the only one receiving signals
+    for (int i = 1; i < nservers; i++) {
+        errno = pthread_create(&servers[i].thread, NULL, worker_main, &servers[i]);
+        if (errno != 0) {
+            stop_workers();
+            for (int j = 1; j < i; j++) {
+                (void) pthread_join(servers[j].thread, NULL);
             }
-        }
-        if (error) {
-            break;
-        } else if (correct_guesses == SLOTS) {
-            /* won */
-            (void) printf("Runden: %d\n", round);
-            break;
+            bail_out(EXIT_FAILURE, "pthread_create");
         }
     }
 
+    //Serve games until SIGINT or SIGTERM
+    if (server_run(&servers[0], &unblocked) < 0) {
+        (void) fprintf(stderr, "%s: %s: %s\n", progname,
+            options.uring ? "io_uring_enter" : "epoll_pwait", strerror(errno));
+        ret = EXIT_FAILURE;
+    }
+    stop_workers();
+    for (int i = 1; i < nservers; i++) {
+        (void) pthread_join(servers[i].thread, NULL);
+    }
+
     /* we are done */
     free_resources();
     return ret;
@@ -413,15 +1571,96 @@ static void parse_args(int argc, char **argv, struct opts *options)
     char *endptr;
     enum { beige, darkblue, green, orange, red, black, violet, white };
 
+    int c;
+
     if(argc > 0) {
         progname = argv[0];
     }
-    if (argc != 3) {
+
+    options->workers = 1;
+    options->uring = 0;
+    options->evil = 0;
+    options->table = NULL;
+    options->metrics_path = NULL;
+    options->idle_seconds = IDLE_SECONDS;
+    options->game_seconds = GAME_SECONDS;
+    options->geometry = score_geometry(SLOTS, COLORS);
+    while ((c = getopt(argc, argv, "ueg:w:m:i:t:")) != -1) {
+        switch (c) {
+            case 'g': {
+                long int slots = strtol(optarg, &endptr, 10);
+                long int colors = -1;
+
+                if (endptr != optarg && *endptr == 'x') {
+                    char *colors_arg = endptr + 1;
+
+                    colors = strtol(colors_arg, &endptr, 10);
+                    if (endptr == colors_arg || *endptr != '\0') {
+                        colors = -1;
+                    }
+                }
+                options->geometry = score_geometry((int) slots, (int) colors);
+                if (options->geometry == NULL) {
+                    char names[128] = "";
+
+                    for (i = 0; score_geometries[i].name != NULL; ++i) {
+                        (void) strncat(names, " ", sizeof(names) - strlen(names) - 1);
+                        (void) strncat(names, score_geometries[i].name, sizeof(names) - strlen(names) - 1);
+                    }
+                    errno = 0;
+                    bail_out(EXIT_FAILURE, "<geometry> has to be one of%s", names);
+                }
+                break;
+            }
+            case 'u':
+                options->uring = 1;
+                break;
+            case 'e':
+                options->evil = 1;
+                break;
+            case 'm':
+                options->metrics_path = optarg;
+                break;
+            case 'i':
+            case 't': {
+                long int seconds = strtol(optarg, &endptr, 10);
+
+                if (endptr == optarg || *endptr != '\0' || seconds < 0 || seconds > MAX_SECONDS) {
+                    errno = 0;
+                    bail_out(EXIT_FAILURE, "<%s-seconds> has to be between 0 (none) and %d",
+                        c == 'i' ? "idle" : "game", MAX_SECONDS);
+                }
+                if (c == 'i') {
+                    options->idle_seconds = seconds;
+                } else {
+                    options->game_seconds = seconds;
+                }
+                break;
+            }
+            case 'w':
+                errno = 0;
+                options->workers = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || *endptr != '\0'
+                    || options->workers < 1 || options->workers > MAX_WORKERS) {
+                    errno = 0;
+                    bail_out(EXIT_FAILURE,
+                        "<workers> has to be between 1 and %d", MAX_WORKERS);
+                }
+                break;
+            default:
+                errno = 0;
+                bail_out(EXIT_FAILURE,
+                    "Usage: %s [-u] [-g slotsxcolors] [-w workers] [-m stats-file] [-i idle-seconds] [-t game-seconds]"
+            " <server-port> <secret-sequence>\n       %s -e [options] <server-port>", progname, progname);
+        }
+    }
+    if (argc - optind != (options->evil ? 1 : 2)) {
+        errno = 0;
         bail_out(EXIT_FAILURE,
-            "Usage: %s <server-port> <secret-sequence>", progname);
+            "Usage: %s [-u] [-g slotsxcolors] [-w workers] [-m stats-file] [-i idle-seconds] [-t game-seconds]"
+            " <server-port> <secret-sequence>\n       %s -e [options] <server-port>", progname, progname);
     }
-    port_arg = argv[1];
-    secret_arg = argv[2];
+    port_arg = argv[optind];
 
     errno = 0;
     options->portno = strtol(port_arg, &endptr, 10);
@@ -449,13 +1688,23 @@ static void parse_args(int argc, char **argv, struct opts *options)
         bail_out(EXIT_FAILURE, "Use a valid TCP/IP port range (1-65535)");
     }
 
-    if (strlen(secret_arg) != SLOTS) {
+    /* an evil host scores against every code left */
+    if (options->evil) {
+        evil = evil_create(options->geometry);
+        if (evil == NULL) {
+            bail_out(EXIT_FAILURE, "evil_create");
+        }
+        return;
+    }
+    secret_arg = argv[optind + 1];
+
+    if (strlen(secret_arg) != (size_t) options->geometry->slots) {
         bail_out(EXIT_FAILURE,
-            "<secret-sequence> has to be %d chars long", SLOTS);
+            "<secret-sequence> has to be %d chars long", options->geometry->slots);
     }
 
     /* read secret */
-    for (i = 0; i < SLOTS; ++i) {
+    for (i = 0; i < options->geometry->slots; ++i) {
         uint8_t color = 0;
         switch (secret_arg[i]) {
             case 'b':
@@ -485,6 +1734,15 @@ static void parse_args(int argc, char **argv, struct opts *options)
             default:
                 bail_out(EXIT_FAILURE, "Bad Color '%c' in <secret-sequence>", secret_arg[i]);
         }
+        if (color >= options->geometry->colors) {
+            bail_out(EXIT_FAILURE, "Color '%c' is not on a %s board", secret_arg[i], options->geometry->name);
+        }
         options->secret[i] = color;
     }
+
+    /* answer every possible guess in advance */
+    options->table = score_table_get(options->geometry, options->geometry->pack(options->secret));
+    if (options->table == NULL) {
+        bail_out(EXIT_FAILURE, "score_table_get");
+    }
 }
@@ -0,0 +1,79 @@
+/**
+ * @file    slab.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the slab module
+ **/
+
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+
+void slab_init(struct slab *slab, size_t size, unsigned int shift)
+{
+    (void) memset(slab, 0, sizeof(*slab));
+    slab->size = size;
+    slab->shift = shift;
+    slab->free = SLAB_NONE;
+}
+
+void slab_destroy(struct slab *slab)
+{
+    for (uint32_t i = 0; i < slab->nchunks; ++i) {
+        free(slab->chunks[i]);
+    }
+    free(slab->chunks);
+    slab->chunks = NULL;
+    slab->nchunks = slab->capacity = 0;
+    slab->free = SLAB_NONE;
+    slab->used = 0;
+}
+
+uint32_t slab_alloc(struct slab *slab)
+{
+    uint32_t index = slab->free;
+
+    if (index == SLAB_NONE) {
+        const uint32_t count = 1u << slab->shift;
+        const uint32_t first = slab->nchunks << slab->shift;
+        uint8_t *chunk;
+
+        if (first + (uint64_t) count >= SLAB_NONE) {
+            return SLAB_NONE;
+        }
+        if (slab->nchunks == slab->capacity) {
+            uint32_t capacity = slab->capacity == 0 ? 16 : slab->capacity * 2;
+            uint8_t **chunks = realloc(slab->chunks, capacity * sizeof(*chunks));
+
+            if (chunks == NULL) {
+                return SLAB_NONE;
+            }
+            slab->chunks = chunks;
+            slab->capacity = capacity;
+        }
+        chunk = malloc(slab->size << slab->shift);
+        if (chunk == NULL) {
+            return SLAB_NONE;
+        }
+        slab->chunks[slab->nchunks++] = chunk;
+
+        /* link the new objects in index order */
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t next = i + 1 < count ? first + i + 1 : SLAB_NONE;
+
+            (void) memcpy(chunk + (size_t) i * slab->size, &next, sizeof(next));
+        }
+        index = first;
+    }
+
+    (void) memcpy(&slab->free, slab_get(slab, index), sizeof(slab->free));
+    slab->used++;
+    return index;
+}
+
+void slab_release(struct slab *slab, uint32_t index)
+{
+    (void) memcpy(slab_get(slab, index), &slab->free, sizeof(slab->free));
+    slab->free = index;
+    slab->used--;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file    slab.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Pool of equally sized objects for the mastermind server
+ * @details Objects are carved from chunks of 1 << shift objects and named by a 32 bit index, so a reference
+ * takes half the space of a pointer. Chunks are never moved or given back before slab_destroy(), so an object
+ * keeps its address while it is allocated. Free objects form a list through their first four bytes, which
+ * makes allocating and releasing a few instructions without any per object overhead. A slab is used by one
+ * thread only.
+ **/
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLAB_NONE (UINT32_MAX)      /**< index of no object */
+
+/**
+ * @brief a pool of objects
+ */
+struct slab {
+    uint8_t **chunks;
+    uint32_t nchunks;
+    uint32_t capacity;              /**< entries of chunks */
+    size_t size;                    /**< bytes per object */
+    unsigned int shift;             /**< log2 of the objects per chunk */
+    uint32_t free;                  /**< first free object, SLAB_NONE if every chunk is full */
+    uint32_t used;                  /**< allocated objects */
+};
+
+/**
+ * @brief Sets up an empty slab
+ * @param slab the slab
+ * @param size bytes per object, at least 4
+ * @param shift log2 of the objects per chunk
+ */
+void slab_init(struct slab *slab, size_t size, unsigned int shift);
+
+/**
+ * @brief Frees all chunks, which releases all objects
+ * @param slab the slab
+ */
+void slab_destroy(struct slab *slab);
+
+/**
+ * @brief Allocates an object, its contents are undefined
+ * @param slab the slab
+ * @return index of the object, SLAB_NONE if out of memory
+ */
+uint32_t slab_alloc(struct slab *slab);
+
+/**
+ * @brief Releases an object
+ * @param slab the slab
+ * @param index index of the object
+ */
+void slab_release(struct slab *slab, uint32_t index);
+
+/**
+ * @brief An allocated object
+ * @param slab the slab
+ * @param index index of the object
+ * @return the object
+ */
+static inline void *slab_get(const struct slab *slab, uint32_t index)
+{
+    return slab->chunks[index >> slab->shift] + (size_t) (index & ((1u << slab->shift) - 1)) * slab->size;
+}
+
+#endif // SLAB_H
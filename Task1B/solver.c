@@ -0,0 +1,509 @@
+/**
+ * @file    solver.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the solver module
+ **/
+
+#include "solver.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Bit 0 of every color of a code */
+#define LOW_BITS (0x1249)
+/* Bit 7 of every byte */
+#define HIGH_BYTES (0x8080808080808080ull)
+/* Candidate guesses taken from a range at once */
+#define CHUNK (8)
+
+/**
+ * @brief A candidate guess and its evaluation
+ */
+struct choice {
+    uint64_t spread;        /* sum of squared partition sizes */
+    int consistent;         /* the guess may be the secret */
+    int guess;              /* code of the guess, -1 for none */
+};
+
+/**
+ * @brief A thread of the pool
+ * @details aligned to a cache line, so that stealing does not disturb the neighbours
+ */
+struct worker {
+    struct solver_pool *pool;
+    pthread_t thread;
+    uint64_t range;         /* chunks left to evaluate: first | end << 32, changed atomically */
+    struct choice best;     /* best guess of the worker in the current job */
+} __attribute__((aligned(64)));
+
+/**
+ * @brief Threads which evaluate guesses together
+ */
+struct solver_pool {
+    int threads;
+    struct worker *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;                /* a job was posted or the pool stops */
+    pthread_cond_t finished;            /* a worker finished the job */
+    unsigned long job;                  /* number of the current job */
+    int done;                           /* workers which finished the job */
+    int stop;
+
+    const struct solver *solver;        /* the job */
+    const uint16_t *candidates;
+    uint32_t count;
+};
+
+/**
+ * @brief Number of pins of every color of every code, one byte per color
+ */
+static uint64_t colors[CODES];
+static pthread_once_t colors_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief The first guess, which is the same in every game
+ */
+static int opening = -1;
+static pthread_once_t opening_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Fills colors
+ */
+static void count_colors(void);
+
+/**
+ * @brief Fills opening
+ */
+static void choose_opening(void);
+
+/**
+ * @brief Chooses a guess, see solver_next()
+ * @param solver the solver
+ * @param pool threads to use, NULL for the calling thread only
+ * @return code of the guess, -1 if no code is consistent with the answers
+ */
+static int choose(const struct solver *solver, struct solver_pool *pool);
+
+/**
+ * @brief Whether a guess is better than another
+ * @details a strict total order, so the best guess does not depend on the order of evaluation
+ * @param a the guess
+ * @param b the other guess
+ * @return 1 if a is better, 0 else
+ */
+static int better(const struct choice *a, const struct choice *b);
+
+/**
+ * @brief Evaluates candidate guesses
+ * @param solver the solver
+ * @param candidates codes of the guesses
+ * @param count number of guesses
+ * @param best best guess so far, updated
+ */
+static void evaluate(const struct solver *solver, const uint16_t *candidates, uint32_t count, struct choice *best);
+
+/**
+ * @brief Evaluates chunks of the current job until no chunk is left
+ * @param pool the pool
+ * @param self the calling worker
+ */
+static void work(struct solver_pool *pool, struct worker *self);
+
+/**
+ * @brief Takes the next chunk from the range of a worker
+ * @param self the worker
+ * @param chunk the chunk taken
+ * @return 1 if a chunk was taken, 0 if the range is empty
+ */
+static int take(struct worker *self, uint32_t *chunk);
+
+/**
+ * @brief Takes the upper half of the range of another worker
+ * @param pool the pool
+ * @param self the calling worker, its range must be empty
+ * @param chunk the first chunk taken, the rest becomes the range of self
+ * @return 1 if a chunk was taken, 0 if all ranges are empty
+ */
+static int steal(struct solver_pool *pool, struct worker *self, uint32_t *chunk);
+
+/**
+ * @brief Entry point of a pool thread
+ * @param arg the worker
+ * @return NULL
+ */
+static void *worker_main(void *arg);
+
+/**
+ * @brief Scores a guess against a secret using the color counts
+ * @param guess code of the guess
+ * @param secret code of the secret
+ * @return red | white << SHIFT_WIDTH
+ */
+static inline uint8_t score(uint32_t guess, uint32_t secret);
+
+/**
+ * @brief Sum of squared partition sizes of a guess
+ * @param solver the solver
+ * @param guess code of the guess
+ * @return the sum
+ */
+static uint64_t spread(const struct solver *solver, uint32_t guess);
+
+static void count_colors(void)
+{
+    for (uint32_t code = 0; code < CODES; ++code) {
+        uint64_t count = 0;
+
+        for (int j = 0; j < SLOTS; ++j) {
+            count += 1ull << (8 * ((code >> (j * SHIFT_WIDTH)) & (COLORS - 1)));
+        }
+        colors[code] = count;
+    }
+}
+
+static inline uint8_t score(uint32_t guess, uint32_t secret)
+{
+    const uint64_t g = colors[guess];
+    const uint64_t s = colors[secret];
+    uint32_t x = guess ^ secret;
+    uint64_t smaller;
+    uint64_t common;
+    int red;
+
+    /* a color matches if all of its bits are equal */
+    x = ~(x | x >> 1 | x >> 2) & LOW_BITS;
+    red = __builtin_popcount(x);
+
+    /* per color min(g, s), counts are below 128 so the subtraction does not borrow across bytes */
+    smaller = ((g | HIGH_BYTES) - s) & HIGH_BYTES;
+    smaller = (smaller >> 7) * 0xff;
+    common = (s & smaller) | (g & ~smaller);
+    common = (common * 0x0101010101010101ull) >> 56;
+
+    return (uint8_t) (red | (((int) common - red) << SHIFT_WIDTH));
+}
+
+uint8_t solver_score(uint16_t guess, uint16_t secret)
+{
+    (void) pthread_once(&colors_once, count_colors);
+    return score(guess & CODE_MASK, secret & CODE_MASK);
+}
+
+void solver_init(struct solver *solver)
+{
+    (void) pthread_once(&colors_once, count_colors);
+    (void) memset(solver->consistent, 0xff, sizeof(solver->consistent));
+    solver->remaining = CODES;
+    solver->round = 0;
+}
+
+static uint64_t spread(const struct solver *solver, uint32_t guess)
+{
+    uint32_t partition[SOLVER_ANSWERS];
+    uint64_t sum = 0;
+
+    (void) memset(partition, 0, sizeof(partition));
+    for (uint32_t w = 0; w < CODES / 64; ++w) {
+        uint64_t bits = solver->consistent[w];
+
+        while (bits != 0) {
+            partition[score(guess, w * 64 + __builtin_ctzll(bits))]++;
+            bits &= bits - 1;
+        }
+    }
+    for (int a = 0; a < SOLVER_ANSWERS; ++a) {
+        sum += (uint64_t) partition[a] * partition[a];
+    }
+    return sum;
+}
+
+static void choose_opening(void)
+{
+    struct solver solver;
+
+    solver_init(&solver);
+    opening = choose(&solver, NULL);
+}
+
+int solver_next(const struct solver *solver)
+{
+    return solver_next_parallel(solver, NULL);
+}
+
+int solver_next_parallel(const struct solver *solver, struct solver_pool *pool)
+{
+    if (solver->round == 0) {
+        (void) pthread_once(&opening_once, choose_opening);
+        return opening;
+    }
+    return choose(solver, pool);
+}
+
+static int choose(const struct solver *solver, struct solver_pool *pool)
+{
+    uint16_t candidates[CODES];
+    struct choice best = { UINT64_MAX, 0, -1 };
+    uint32_t count = 0;
+    uint32_t step;
+    int all;
+
+    if (solver->remaining <= 2) {
+        /* any consistent code is as good as it gets */
+        for (uint32_t w = 0; w < CODES / 64; ++w) {
+            if (solver->consistent[w] != 0) {
+                return (int) (w * 64 + __builtin_ctzll(solver->consistent[w]));
+            }
+        }
+        return -1;
+    }
+
+    /* which guesses fit into the budget */
+    all = (uint64_t) CODES * solver->remaining <= SOLVER_BUDGET;
+    step = 1;
+    if (!all && (uint64_t) solver->remaining * solver->remaining > SOLVER_BUDGET) {
+        step = (uint32_t) (((uint64_t) solver->remaining * solver->remaining + SOLVER_BUDGET - 1) / SOLVER_BUDGET);
+    }
+
+    for (uint32_t guess = 0, seen = 0; guess < CODES; ++guess) {
+        const int consistent = (solver->consistent[guess / 64] >> (guess % 64)) & 1;
+
+        if (all || (consistent && seen++ % step == 0)) {
+            candidates[count++] = (uint16_t) guess;
+        }
+    }
+
+    if (pool == NULL || pool->threads == 1) {
+        evaluate(solver, candidates, count, &best);
+        return best.guess;
+    }
+
+    /* post the job, split into one range of chunks per worker */
+    const uint32_t chunks = (count + CHUNK - 1) / CHUNK;
+
+    (void) pthread_mutex_lock(&pool->lock);
+    pool->solver = solver;
+    pool->candidates = candidates;
+    pool->count = count;
+    for (int i = 0; i < pool->threads; ++i) {
+        const uint64_t first = (uint64_t) chunks * i / pool->threads;
+        const uint64_t end = (uint64_t) chunks * (i + 1) / pool->threads;
+
+        pool->workers[i].best = best;
+        __atomic_store_n(&pool->workers[i].range, first | end << 32, __ATOMIC_RELAXED);
+    }
+    pool->done = 0;
+    pool->job++;
+    (void) pthread_cond_broadcast(&pool->wake);
+    (void) pthread_mutex_unlock(&pool->lock);
+
+    /* the calling thread is worker 0 */
+    work(pool, &pool->workers[0]);
+
+    (void) pthread_mutex_lock(&pool->lock);
+    while (pool->done < pool->threads - 1) {
+        (void) pthread_cond_wait(&pool->finished, &pool->lock);
+    }
+    (void) pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; ++i) {
+        if (better(&pool->workers[i].best, &best)) {
+            best = pool->workers[i].best;
+        }
+    }
+    return best.guess;
+}
+
+static int better(const struct choice *a, const struct choice *b)
+{
+    if (a->spread != b->spread) {
+        return a->spread < b->spread;
+    }
+    if (a->consistent != b->consistent) {
+        return a->consistent > b->consistent;
+    }
+    return a->guess < b->guess;
+}
+
+static void evaluate(const struct solver *solver, const uint16_t *candidates, uint32_t count, struct choice *best)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        struct choice choice;
+
+        choice.guess = candidates[i];
+        choice.consistent = (solver->consistent[choice.guess / 64] >> (choice.guess % 64)) & 1;
+        choice.spread = spread(solver, choice.guess);
+        if (better(&choice, best)) {
+            *best = choice;
+        }
+    }
+}
+
+static void work(struct solver_pool *pool, struct worker *self)
+{
+    uint32_t chunk;
+
+    while (take(self, &chunk) || steal(pool, self, &chunk)) {
+        const uint32_t first = chunk * CHUNK;
+        const uint32_t count = pool->count - first < CHUNK ? pool->count - first : CHUNK;
+
+        evaluate(pool->solver, pool->candidates + first, count, &self->best);
+    }
+}
+
+static int take(struct worker *self, uint32_t *chunk)
+{
+    uint64_t range = __atomic_load_n(&self->range, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        const uint32_t first = (uint32_t) range;
+        const uint32_t end = (uint32_t) (range >> 32);
+
+        if (first >= end) {
+            return 0;
+        }
+        if (__atomic_compare_exchange_n(&self->range, &range, (uint64_t) (first + 1) | (uint64_t) end << 32,
+                                        0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *chunk = first;
+            return 1;
+        }
+    }
+}
+
+static int steal(struct solver_pool *pool, struct worker *self, uint32_t *chunk)
+{
+    const int index = (int) (self - pool->workers);
+
+    for (int k = 1; k < pool->threads; ++k) {
+        struct worker *victim = &pool->workers[(index + k) % pool->threads];
+        uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+        for (;;) {
+            const uint32_t first = (uint32_t) range;
+            const uint32_t end = (uint32_t) (range >> 32);
+            const uint32_t middle = first + (end - first) / 2;
+
+            if (first >= end) {
+                break;
+            }
+            /* the victim keeps the lower half, a single chunk is taken whole */
+            if (__atomic_compare_exchange_n(&victim->range, &range, (uint64_t) first | (uint64_t) middle << 32,
+                                            0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&self->range, (uint64_t) (middle + 1) | (uint64_t) end << 32, __ATOMIC_RELEASE);
+                *chunk = middle;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *self = arg;
+    struct solver_pool *pool = self->pool;
+    unsigned long job = 0;
+
+    for (;;) {
+        (void) pthread_mutex_lock(&pool->lock);
+        while (pool->job == job && !pool->stop) {
+            (void) pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->stop) {
+            (void) pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = pool->job;
+        (void) pthread_mutex_unlock(&pool->lock);
+
+        work(pool, self);
+
+        (void) pthread_mutex_lock(&pool->lock);
+        pool->done++;
+        (void) pthread_cond_signal(&pool->finished);
+        (void) pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+struct solver_pool *solver_pool_create(int threads)
+{
+    struct solver_pool *pool;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (posix_memalign((void **) &pool->workers, sizeof(*pool->workers), threads * sizeof(*pool->workers)) != 0) {
+        free(pool);
+        return NULL;
+    }
+    (void) memset(pool->workers, 0, threads * sizeof(*pool->workers));
+    (void) pthread_mutex_init(&pool->lock, NULL);
+    (void) pthread_cond_init(&pool->wake, NULL);
+    (void) pthread_cond_init(&pool->finished, NULL);
+
+    /* worker 0 is the thread calling solver_next_parallel() */
+    pool->threads = 1;
+    pool->workers[0].pool = pool;
+    for (int i = 1; i < threads; ++i) {
+        pool->workers[i].pool = pool;
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            break;
+        }
+        pool->threads++;
+    }
+
+    return pool;
+}
+
+void solver_pool_destroy(struct solver_pool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    (void) pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    (void) pthread_cond_broadcast(&pool->wake);
+    (void) pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->threads; ++i) {
+        (void) pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    (void) pthread_cond_destroy(&pool->finished);
+    (void) pthread_cond_destroy(&pool->wake);
+    (void) pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+void solver_update(struct solver *solver, uint16_t guess, uint8_t answer)
+{
+    const uint8_t wanted = answer & (SOLVER_ANSWERS - 1);
+    uint32_t remaining = 0;
+
+    for (uint32_t w = 0; w < CODES / 64; ++w) {
+        uint64_t bits = solver->consistent[w];
+        uint64_t keep = 0;
+
+        while (bits != 0) {
+            const int b = __builtin_ctzll(bits);
+
+            if (score(guess & CODE_MASK, w * 64 + b) == wanted) {
+                keep |= 1ull << b;
+            }
+            bits &= bits - 1;
+        }
+        solver->consistent[w] = keep;
+        remaining += __builtin_popcountll(keep);
+    }
+
+    solver->remaining = remaining;
+    solver->round++;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    solver.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Guessing strategy for mastermind
+ * @details The solver keeps the codes which are still consistent with all answers as a bitset of CODES bits.
+ * The next guess is the code whose answers split the consistent codes into the smallest expected remainder,
+ * i.e. the smallest sum of squared partition sizes. Ties prefer consistent codes, then the lowest code, so
+ * the solver is deterministic. To keep a move in the range of milliseconds, at most SOLVER_BUDGET scores are
+ * computed per move: all codes are tried as guesses once few codes are left, otherwise only consistent ones,
+ * sampled evenly if there are too many.
+ *
+ * A solver pool evaluates the candidate guesses of a move on several threads. The candidates are split into
+ * chunks and every thread starts on an equal range of them; a thread which runs out steals the upper half of
+ * the range of another one. Every thread keeps its own partition counts and best guess, which are merged by
+ * the same total order at the end, so the guess does not depend on the number of threads.
+ **/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+#include "mastermind-common.h"
+
+#define SOLVER_BUDGET (1 << 21)     /**< most scores computed per move */
+#define SOLVER_ANSWERS (1 << 6)     /**< red | white << SHIFT_WIDTH is below this */
+
+/**
+ * @brief State of a game from the view of the client
+ */
+struct solver {
+    uint64_t consistent[CODES / 64];    /**< bit c is set if code c may still be the secret */
+    uint32_t remaining;                 /**< number of set bits in consistent */
+    int round;                          /**< guesses made */
+};
+
+/**
+ * @brief Threads evaluating guesses, see solver_pool_create()
+ */
+struct solver_pool;
+
+/**
+ * @brief Starts a new game
+ * @param solver the solver
+ */
+void solver_init(struct solver *solver);
+
+/**
+ * @brief Chooses the next guess
+ * @param solver the solver
+ * @return code of the guess, -1 if no code is consistent with the answers
+ */
+int solver_next(const struct solver *solver);
+
+/**
+ * @brief Chooses the next guess with the help of a pool
+ * @details gives the same guess as solver_next(), the pool can only be used by one thread at a time
+ * @param solver the solver
+ * @param pool the pool, NULL to use only the calling thread
+ * @return code of the guess, -1 if no code is consistent with the answers
+ */
+int solver_next_parallel(const struct solver *solver, struct solver_pool *pool);
+
+/**
+ * @brief Starts the threads of a pool
+ * @details the calling thread of solver_next_parallel() takes part, so threads - 1 threads are started
+ * @param threads number of threads, at least 1
+ * @return the pool, NULL if out of memory
+ */
+struct solver_pool *solver_pool_create(int threads);
+
+/**
+ * @brief Stops the threads of a pool and frees it
+ * @param pool the pool, may be NULL
+ */
+void solver_pool_destroy(struct solver_pool *pool);
+
+/**
+ * @brief Removes the codes which would not have given an answer
+ * @param solver the solver
+ * @param guess code of the guess
+ * @param answer answer of the server, the error bits are ignored
+ */
+void solver_update(struct solver *solver, uint16_t guess, uint8_t answer);
+
+/**
+ * @brief Fast scoring
+ * @details equal to score_compute()
+ * @param guess code of the guess
+ * @param secret code of the secret
+ * @return red | white << SHIFT_WIDTH
+ */
+uint8_t solver_score(uint16_t guess, uint16_t secret);
+
+#endif // SOLVER_H
@@ -0,0 +1,215 @@
+/**
+ * @file    uring.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the uring module
+ **/
+
+#define _GNU_SOURCE
+
+#include "uring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+int uring_init(struct uring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    unsigned char *sq;
+    unsigned char *cq;
+    int fd;
+
+    (void) memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    /* COOP_TASKRUN skips the interrupts for work of a thread that enters the ring anyway */
+    (void) memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = entries * 4;
+    fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0 && errno == EINVAL) {
+        (void) memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    ring->fd = fd;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+    }
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        uring_free(ring);
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            uring_free(ring);
+            return -1;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uring_free(ring);
+        return -1;
+    }
+
+    sq = ring->sq_map;
+    cq = ring->cq_map != NULL ? ring->cq_map : ring->sq_map;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    /* entry i always sits in slot i of the array */
+    for (unsigned i = 0; i < ring->sq_entries; i++) {
+        ring->sq_array[i] = i;
+    }
+    return 0;
+}
+
+void uring_free(struct uring *ring)
+{
+    if (ring->sqes != NULL) {
+        (void) munmap(ring->sqes, ring->sqes_size);
+        ring->sqes = NULL;
+    }
+    if (ring->cq_map != NULL) {
+        (void) munmap(ring->cq_map, ring->cq_map_size);
+        ring->cq_map = NULL;
+    }
+    if (ring->sq_map != NULL) {
+        (void) munmap(ring->sq_map, ring->sq_map_size);
+        ring->sq_map = NULL;
+    }
+    if (ring->fd >= 0) {
+        (void) close(ring->fd);
+        ring->fd = -1;
+    }
+}
+
+struct io_uring_sqe *uring_sqe(struct uring *ring)
+{
+    struct io_uring_sqe *sqe;
+    unsigned tail = *ring->sq_tail + ring->queued;
+
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (uring_enter(ring, 0, NULL) < 0) {
+            return NULL;
+        }
+        tail = *ring->sq_tail;
+    }
+
+    sqe = &ring->sqes[tail & ring->sq_mask];
+    (void) memset(sqe, 0, sizeof(*sqe));
+    ring->queued++;
+    return sqe;
+}
+
+int uring_enter(struct uring *ring, unsigned wait, const sigset_t *sigmask)
+{
+    unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+    unsigned submit = ring->queued;
+    int r;
+
+    /* publish the entries, the kernel reads them up to the tail */
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + submit, __ATOMIC_RELEASE);
+    ring->queued = 0;
+
+    /* EINTR means nothing was submitted, so the caller may simply enter again */
+    do {
+        r = (int) syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, sigmask, _NSIG / 8);
+    } while (r < 0 && errno == EINTR && sigmask == NULL);
+
+    return r < 0 ? -1 : 0;
+}
+
+int uring_buffers_init(struct uring *ring, struct uring_buffers *buffers, uint16_t group,
+                       unsigned count, unsigned size)
+{
+    struct io_uring_buf_reg reg;
+    void *map;
+
+    (void) memset(buffers, 0, sizeof(*buffers));
+    buffers->count = count;
+    buffers->size = size;
+    buffers->group = group;
+
+    /* the kernel wants the ring page aligned */
+    buffers->ring_size = count * sizeof(struct io_uring_buf);
+    map = mmap(NULL, buffers->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    buffers->ring = map;
+
+    buffers->data = malloc((size_t) count * size);
+    if (buffers->data == NULL) {
+        uring_buffers_free(ring, buffers);
+        return -1;
+    }
+
+    (void) memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t) buffers->ring;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uring_buffers_free(ring, buffers);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        uring_buffer_put(buffers, (uint16_t) i);
+    }
+    return 0;
+}
+
+void uring_buffers_free(struct uring *ring, struct uring_buffers *buffers)
+{
+    struct io_uring_buf_reg reg;
+
+    if (buffers->ring != NULL) {
+        (void) memset(&reg, 0, sizeof(reg));
+        reg.bgid = buffers->group;
+        (void) syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        (void) munmap(buffers->ring, buffers->ring_size);
+        buffers->ring = NULL;
+    }
+    free(buffers->data);
+    buffers->data = NULL;
+}
+
+void uring_buffer_put(struct uring_buffers *buffers, uint16_t id)
+{
+    struct io_uring_buf *buf = &buffers->ring->bufs[buffers->tail & (buffers->count - 1)];
+
+    buf->addr = (uintptr_t) uring_buffer(buffers, id);
+    buf->len = buffers->size;
+    buf->bid = id;
+    buffers->tail++;
+    __atomic_store_n(&buffers->ring->tail, buffers->tail, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,153 @@
+/**
+ * @file    uring.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Minimal io_uring rings for the mastermind server
+ * @details Talks to the kernel with the raw io_uring_setup/enter/register system calls, there is no liburing.
+ * Requests are written to submission queue entries taken with uring_sqe() and handed to the kernel in one
+ * go by uring_enter(), which also waits for completions. Completions are read with uring_cqe() and released
+ * with uring_cqe_seen(). A struct uring is used by one thread only.
+ *
+ * A buffer ring is a group of equally sized receive buffers registered with the kernel. Receives with
+ * IOSQE_BUFFER_SELECT pick a free buffer of the group themselves, so a multishot receive can stay armed on
+ * every connection without a buffer per connection. The completion names the buffer in its flags, it
+ * belongs to the caller until it is given back with uring_buffer_put().
+ **/
+
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include <linux/io_uring.h>
+
+/**
+ * @brief an io_uring instance with its mapped queues
+ */
+struct uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned queued;                    /**< entries taken, but not yet submitted */
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;                       /**< NULL if the completion queue shares sq_map */
+    size_t cq_map_size;
+    size_t sqes_size;
+};
+
+/**
+ * @brief a group of receive buffers registered with a ring
+ */
+struct uring_buffers {
+    struct io_uring_buf_ring *ring;
+    uint8_t *data;                      /**< count buffers of size bytes */
+    size_t ring_size;
+    unsigned count;                     /**< a power of two */
+    unsigned size;
+    uint16_t group;
+    uint16_t tail;
+};
+
+/**
+ * @brief Sets up an io_uring instance
+ * @param ring the ring
+ * @param entries size of the submission queue, the completion queue is four times larger
+ * @return 0 on success, -1 on error, e.g. if the kernel has no io_uring
+ */
+int uring_init(struct uring *ring, unsigned entries);
+
+/**
+ * @brief Unmaps the queues and closes the ring, which cancels all requests
+ * @param ring the ring
+ */
+void uring_free(struct uring *ring);
+
+/**
+ * @brief Takes a cleared submission queue entry
+ * @details submits the queued entries first if the submission queue is full
+ * @param ring the ring
+ * @return the entry, NULL if submitting failed
+ */
+struct io_uring_sqe *uring_sqe(struct uring *ring);
+
+/**
+ * @brief Submits all queued entries and waits for completions
+ * @param ring the ring
+ * @param wait completions to wait for, 0 to only submit
+ * @param sigmask signal mask while waiting, NULL to keep the current one
+ * @return 0 on success, -1 on error (EINTR if a signal was caught)
+ */
+int uring_enter(struct uring *ring, unsigned wait, const sigset_t *sigmask);
+
+/**
+ * @brief The oldest unread completion
+ * @param ring the ring
+ * @return the completion, NULL if there is none
+ */
+static inline struct io_uring_cqe *uring_cqe(struct uring *ring)
+{
+    unsigned head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+/**
+ * @brief Releases the completion returned by uring_cqe()
+ * @param ring the ring
+ */
+static inline void uring_cqe_seen(struct uring *ring)
+{
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Registers a group of receive buffers
+ * @param ring the ring
+ * @param buffers the buffer group
+ * @param group id of the group, used as buf_group of the receives
+ * @param count number of buffers, a power of two
+ * @param size bytes per buffer
+ * @return 0 on success, -1 on error
+ */
+int uring_buffers_init(struct uring *ring, struct uring_buffers *buffers, uint16_t group,
+                       unsigned count, unsigned size);
+
+/**
+ * @brief Unregisters and frees a group of receive buffers
+ * @param ring the ring
+ * @param buffers the buffer group
+ */
+void uring_buffers_free(struct uring *ring, struct uring_buffers *buffers);
+
+/**
+ * @brief A buffer picked by the kernel
+ * @param buffers the buffer group
+ * @param id buffer id, flags >> IORING_CQE_BUFFER_SHIFT of the completion
+ * @return the first byte of the buffer
+ */
+static inline uint8_t *uring_buffer(const struct uring_buffers *buffers, uint16_t id)
+{
+    return buffers->data + (size_t) id * buffers->size;
+}
+
+/**
+ * @brief Gives a buffer back to the kernel
+ * @param buffers the buffer group
+ * @param id buffer id
+ */
+void uring_buffer_put(struct uring_buffers *buffers, uint16_t id);
+
+#endif // URING_H
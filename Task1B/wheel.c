@@ -0,0 +1,126 @@
+/**
+ * @file    wheel.c
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Implementation of the wheel module
+ **/
+
+#include "wheel.h"
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+/**
+ * @brief Links a timer into the slot where its expiry belongs, seen from wheel->now
+ * @param wheel the wheel
+ * @param index slab index of the object
+ * @param timer its timer
+ */
+static void link_timer(struct wheel *wheel, uint32_t index, struct wheel_timer *timer)
+{
+    uint32_t delta = timer->expires - wheel->now;
+    int level = 0;
+    uint32_t slot;
+
+    if (delta >= 1u << (WHEEL_LEVELS * WHEEL_BITS)) {
+        delta = (1u << (WHEEL_LEVELS * WHEEL_BITS)) - 1;
+        timer->expires = wheel->now + delta;
+    }
+    while (delta >= 1u << ((level + 1) * WHEEL_BITS)) {
+        level++;
+    }
+    slot = (uint32_t) level * WHEEL_SLOTS + ((timer->expires >> (level * WHEEL_BITS)) & WHEEL_MASK);
+
+    timer->slot = slot;
+    timer->prev = SLAB_NONE;
+    timer->next = wheel->heads[slot];
+    if (timer->next != SLAB_NONE) {
+        wheel_timer(wheel, timer->next)->prev = index;
+    }
+    wheel->heads[slot] = index;
+}
+
+/**
+ * @brief Takes all timers from a slot
+ * @param wheel the wheel
+ * @param slot the slot
+ * @return the first of the timers, still linked by next
+ */
+static uint32_t take_slot(struct wheel *wheel, uint32_t slot)
+{
+    uint32_t first = wheel->heads[slot];
+
+    wheel->heads[slot] = SLAB_NONE;
+    return first;
+}
+
+void wheel_init(struct wheel *wheel, const struct slab *slab, size_t offset)
+{
+    wheel->slab = slab;
+    wheel->offset = offset;
+    wheel->now = 0;
+    for (int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; ++i) {
+        wheel->heads[i] = SLAB_NONE;
+    }
+}
+
+void wheel_add(struct wheel *wheel, uint32_t index, uint32_t expires)
+{
+    struct wheel_timer *timer = wheel_timer(wheel, index);
+
+    /* the slot of the current tick has been handled already */
+    if ((int32_t) (expires - wheel->now) <= 0) {
+        expires = wheel->now + 1;
+    }
+    timer->expires = expires;
+    link_timer(wheel, index, timer);
+}
+
+void wheel_remove(struct wheel *wheel, uint32_t index)
+{
+    struct wheel_timer *timer = wheel_timer(wheel, index);
+
+    if (timer->slot == SLAB_NONE) {
+        return;
+    }
+    if (timer->prev != SLAB_NONE) {
+        wheel_timer(wheel, timer->prev)->next = timer->next;
+    } else {
+        wheel->heads[timer->slot] = timer->next;
+    }
+    if (timer->next != SLAB_NONE) {
+        wheel_timer(wheel, timer->next)->prev = timer->prev;
+    }
+    timer->slot = SLAB_NONE;
+}
+
+void wheel_advance(struct wheel *wheel, uint32_t now, void (*expired)(void *arg, uint32_t index), void *arg)
+{
+    while ((int32_t) (now - wheel->now) > 0) {
+        uint32_t tick = ++wheel->now;
+        uint32_t index;
+
+        /* cascade: when a level wraps, the next slot of the level above moves down */
+        for (int level = 1; level < WHEEL_LEVELS && ((tick >> ((level - 1) * WHEEL_BITS)) & WHEEL_MASK) == 0;
+             ++level) {
+            index = take_slot(wheel, (uint32_t) level * WHEEL_SLOTS + ((tick >> (level * WHEEL_BITS)) & WHEEL_MASK));
+            while (index != SLAB_NONE) {
+                struct wheel_timer *timer = wheel_timer(wheel, index);
+                uint32_t next = timer->next;
+
+                link_timer(wheel, index, timer);
+                index = next;
+            }
+        }
+
+        /* every timer in the slot of this tick expires now */
+        index = take_slot(wheel, tick & WHEEL_MASK);
+        while (index != SLAB_NONE) {
+            struct wheel_timer *timer = wheel_timer(wheel, index);
+            uint32_t next = timer->next;
+
+            timer->slot = SLAB_NONE;
+            expired(arg, index);
+            index = next;
+        }
+    }
+}
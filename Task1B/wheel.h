@@ -0,0 +1,91 @@
+/**
+ * @file    wheel.h
+ * @Author  Yannick Schwarenthorer, 1229026
+ * @date    11. April 2016
+ * @brief   Hierarchical timer wheel for the mastermind server
+ * @details Time is counted in ticks. The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots; a slot of level l
+ * covers WHEEL_SLOTS^l ticks, so a timer sits in the lowest level whose range reaches its expiry. Whenever the
+ * slots of a level wrap around, the next slot of the level above is cascaded: its timers are moved down to
+ * where they belong now. Adding and removing a timer is O(1), and every timer is touched at most once per
+ * level before it expires, however many timers there are.
+ *
+ * The timers live inside the objects of a slab and are linked by slab index, so a timer costs 16 bytes in its
+ * object and the wheel allocates nothing.
+ **/
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "slab.h"
+
+#define WHEEL_BITS (6)
+#define WHEEL_SLOTS (1 << WHEEL_BITS)   /**< slots per level */
+#define WHEEL_LEVELS (4)                /**< timers reach WHEEL_SLOTS^WHEEL_LEVELS - 1 ticks ahead */
+
+/**
+ * @brief a timer, part of an object of the slab
+ */
+struct wheel_timer {
+    uint32_t next;              /**< slab index of the next timer in the slot */
+    uint32_t prev;              /**< slab index of the previous timer, SLAB_NONE for the first */
+    uint32_t expires;           /**< tick of expiry */
+    uint32_t slot;              /**< slot of the timer, SLAB_NONE if it is not on the wheel */
+};
+
+/**
+ * @brief a timer wheel
+ */
+struct wheel {
+    const struct slab *slab;    /**< objects holding the timers */
+    size_t offset;              /**< offset of the struct wheel_timer in an object */
+    uint32_t now;               /**< last tick handled */
+    uint32_t heads[WHEEL_LEVELS * WHEEL_SLOTS];     /**< first timer of every slot */
+};
+
+/**
+ * @brief Sets up an empty wheel at tick 0
+ * @param wheel the wheel
+ * @param slab objects holding the timers
+ * @param offset offset of the struct wheel_timer in an object
+ */
+void wheel_init(struct wheel *wheel, const struct slab *slab, size_t offset);
+
+/**
+ * @brief The timer of an object
+ * @param wheel the wheel
+ * @param index slab index of the object
+ * @return the timer
+ */
+static inline struct wheel_timer *wheel_timer(const struct wheel *wheel, uint32_t index)
+{
+    return (struct wheel_timer *) ((uint8_t *) slab_get(wheel->slab, index) + wheel->offset);
+}
+
+/**
+ * @brief Starts a timer which is not on the wheel
+ * @param wheel the wheel
+ * @param index slab index of the object
+ * @param expires tick of expiry, a past one expires with the next tick
+ */
+void wheel_add(struct wheel *wheel, uint32_t index, uint32_t expires);
+
+/**
+ * @brief Stops a timer
+ * @param wheel the wheel
+ * @param index slab index of the object, its timer need not be on the wheel
+ */
+void wheel_remove(struct wheel *wheel, uint32_t index);
+
+/**
+ * @brief Handles all ticks up to now
+ * @details expired timers are taken from the wheel before the callback, which may add them again
+ * @param wheel the wheel
+ * @param now the current tick
+ * @param expired called with arg and the slab index of every expired timer
+ * @param arg first argument of expired
+ */
+void wheel_advance(struct wheel *wheel, uint32_t now, void (*expired)(void *arg, uint32_t index), void *arg);
+
+#endif // WHEEL_H